@@ -0,0 +1,79 @@
+//
+// Count, sum, min, max and average of the elements of a range passing a
+// filter: five separate pipelines, each re-running the where predicate,
+// against one aggregate() pass, which fuses the filter and all five into a
+// single vector loop.
+//
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bench.hpp"
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    template <typename T>
+    struct at_least
+    {
+        bool operator()(T x) const noexcept { return x >= T{25}; }
+    };
+
+    template <typename T>
+    double run(const char* type, std::mt19937_64& rng)
+    {
+        using namespace cinq;
+
+        std::uniform_int_distribution<int> values{0, 100};
+        double total = 0;
+        for (std::size_t size = std::size_t{1} << 12;
+             size <= (std::size_t{1} << 24); size <<= 4)
+        {
+            std::vector<T> v(size);
+            for (auto& x : v)
+                x = static_cast<T>(values(rng));
+
+            const int runs = static_cast<int>(std::max<std::size_t>(
+                    (std::size_t{1} << 26) / size, 5));
+            const auto filter = at_least<T>{};
+            double sink = 0;
+            auto separate = bench::best_ms([&]
+            {
+                auto filtered = from(v) % where(filter);
+                auto count = std::distance(filtered.begin(), filtered.end());
+                auto sum = filtered % cinq::sum()();
+                auto lo = *std::min_element(filtered.begin(), filtered.end());
+                auto hi = *std::max_element(filtered.begin(), filtered.end());
+                auto avg = static_cast<double>(filtered % cinq::sum()()) / count;
+                return static_cast<double>(count + sum + lo + hi) + avg;
+            }, sink, runs);
+            auto fused = bench::best_ms([&]
+            {
+                auto all = from(v) % where(filter) %
+                           aggregate(cinq::sum(), min(), max(), count(), avg());
+                return static_cast<double>(std::get<0>(all) + std::get<1>(all) +
+                                           std::get<2>(all) + std::get<3>(all)) +
+                       std::get<4>(all);
+            }, sink, runs);
+
+            std::printf("%8s %10zu %14.3f %12.3f %9.2fx\n", type, size,
+                        separate * 1e6 / size, fused * 1e6 / size,
+                        separate / fused);
+            total += sink;
+        }
+        return total;
+    }
+}
+
+int main()
+{
+    std::mt19937_64 rng{42};
+    std::printf("%8s %10s %14s %12s %10s\n", "type", "elements",
+                "separate ns/el", "fused ns/el", "speedup");
+    double sink = run<float>("float", rng);
+    sink += run<double>("double", rng);
+    sink += run<std::int32_t>("int32", rng);
+    sink += run<std::int16_t>("int16", rng);
+    return sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace bench
+{
+
+// Best wall time of several runs, in milliseconds. The result of every run is
+// accumulated into sink so that the measured work cannot be optimized away.
+template <typename Function, typename Sink>
+double best_ms(Function&& fn, Sink& sink, int runs = 5)
+{
+    double best = 1e300;
+    for (int i = 0; i < runs; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        sink += fn();
+        std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+}
@@ -0,0 +1,69 @@
+//
+// Per-key sum and count of rows, with a std::unordered_map loop against
+// group_by % aggregate, for key counts from cache-resident to far beyond.
+// Keys are random 64-bit ids; dense small integers would favour the
+// identity std::hash of unordered_map, which then never collides.
+//
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "bench.hpp"
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    struct row
+    {
+        std::int64_t key;
+        double value;
+    };
+}
+
+int main()
+{
+    using namespace cinq;
+
+    const std::size_t rows = std::size_t{1} << 22;
+    std::mt19937_64 rng{42};
+    std::uniform_real_distribution<double> values{0, 1};
+
+    std::printf("%10s %10s %18s %16s %10s\n", "rows", "keys",
+                "unordered_map ms", "group_by ms", "speedup");
+    double sink = 0;
+    for (std::size_t keys : {std::size_t{16}, std::size_t{1} << 10,
+                             std::size_t{1} << 16, std::size_t{1} << 20})
+    {
+        std::vector<std::int64_t> ids(keys);
+        for (auto& id : ids)
+            id = static_cast<std::int64_t>(rng());
+        std::uniform_int_distribution<std::size_t> key_dist{0, keys - 1};
+        std::vector<row> v(rows);
+        for (auto& r : v)
+            r = {ids[key_dist(rng)], values(rng)};
+
+        auto map = bench::best_ms([&]
+        {
+            std::unordered_map<std::int64_t, std::pair<double, std::size_t>> groups;
+            for (const auto& r : v)
+            {
+                auto& g = groups[r.key];
+                g.first += r.value;
+                ++g.second;
+            }
+            return static_cast<double>(groups.size());
+        }, sink);
+        auto group = bench::best_ms([&]
+        {
+            auto groups = from(v) % group_by(&row::key) %
+                          aggregate(sum(&row::value), count());
+            return static_cast<double>(groups.size());
+        }, sink);
+
+        std::printf("%10zu %10zu %18.1f %16.1f %9.2fx\n", rows, keys, map,
+                    group, map / group);
+    }
+    return sink == 42 ? 1 : 0;
+}
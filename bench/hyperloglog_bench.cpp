@@ -0,0 +1,65 @@
+//
+// Distinct count of random 64-bit ids, exactly with a std::unordered_set
+// against count_distinct_approx, and the merge of two sketches.
+//
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <unordered_set>
+#include <vector>
+#include "bench.hpp"
+#include "cinq/cinq.hpp"
+
+int main()
+{
+    using namespace cinq;
+
+    const std::size_t rows = std::size_t{1} << 22;
+    std::mt19937_64 rng{42};
+    auto id = [](std::uint64_t i) { return i; };
+
+    std::printf("%10s %10s %18s %16s %10s %10s\n", "rows", "distinct",
+                "unordered_set ms", "hyperloglog ms", "speedup", "error");
+    double sink = 0;
+    for (std::size_t distinct : {std::size_t{1} << 10, std::size_t{1} << 16,
+                                 std::size_t{1} << 20, rows})
+    {
+        std::vector<std::uint64_t> ids(distinct);
+        for (auto& i : ids)
+            i = rng();
+        std::uniform_int_distribution<std::size_t> pick{0, distinct - 1};
+        std::vector<std::uint64_t> v(rows);
+        for (auto& x : v)
+            x = ids[pick(rng)];
+
+        std::size_t exact = 0;
+        auto set = bench::best_ms([&]
+        {
+            std::unordered_set<std::uint64_t> seen(v.begin(), v.end());
+            exact = seen.size();
+            return static_cast<double>(exact);
+        }, sink);
+        std::uint64_t approx = 0;
+        auto hll = bench::best_ms([&]
+        {
+            approx = v % count_distinct_approx(id);
+            return static_cast<double>(approx);
+        }, sink);
+
+        std::printf("%10zu %10zu %18.1f %16.1f %9.2fx %9.2f%%\n", rows, exact,
+                    set, hll, set / hll,
+                    100.0 * std::abs(static_cast<double>(approx) - exact) / exact);
+    }
+
+    auto a = from(std::vector<int>{1, 2, 3}) % distinct_sketch([](int i) { return i; }, 18);
+    auto b = a;
+    auto merge = bench::best_ms([&]
+    {
+        for (int i = 0; i < 1000; ++i)
+            a.merge(b);
+        return a.estimate();
+    }, sink);
+    std::printf("merge of 2^18 registers: %.2f us\n", merge);
+    return sink == 42 ? 1 : 0;
+}
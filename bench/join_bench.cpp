@@ -0,0 +1,77 @@
+//
+// Hash join against radix-partitioned hash join for growing build sides and
+// a fixed-size probe side. The partitioned join pays for the partitioning
+// passes up front and wins once the build table no longer fits in cache.
+// The parallel join runs on the shared pool, one worker per hardware thread.
+//
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bench.hpp"
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    struct row
+    {
+        std::uint64_t key;
+        std::uint64_t payload;
+    };
+
+    template <typename Enumerable>
+    std::uint64_t consume(const Enumerable& result)
+    {
+        std::uint64_t sum = 0;
+        for (const auto& r : result)
+            sum += r.first.payload ^ r.second.payload;
+        return sum;
+    }
+}
+
+int main()
+{
+    using namespace cinq;
+
+    const std::size_t probe_size = std::size_t{1} << 22;
+    std::mt19937_64 rng{42};
+
+    std::printf("%12s %14s %14s %10s %14s\n",
+                "build rows", "hash (ms)", "radix (ms)", "speedup",
+                "parallel (ms)");
+
+    std::uint64_t sink = 0;
+    for (std::size_t build_size = std::size_t{1} << 10;
+         build_size <= (std::size_t{1} << 24); build_size <<= 2)
+    {
+        std::vector<row> build(build_size);
+        for (std::size_t i = 0; i < build_size; ++i)
+            build[i] = {rng(), i};
+        std::vector<row> probe(probe_size);
+        for (std::size_t i = 0; i < probe_size; ++i)
+            probe[i] = {build[rng() % build_size].key, i};
+
+        auto hash = bench::best_ms([&]
+        {
+            return consume(from(probe) %
+                           join(build).on_keys(&row::key, &row::key));
+        }, sink, 3);
+        auto radix = bench::best_ms([&]
+        {
+            return consume(from(probe) %
+                           join(build).on_keys(&row::key, &row::key)
+                                      .partitioned());
+        }, sink, 3);
+
+        auto parallel = bench::best_ms([&]
+        {
+            return consume(from(probe) %
+                           join(build).on_keys(&row::key, &row::key)
+                                      .parallel());
+        }, sink, 3);
+
+        std::printf("%12zu %14.2f %14.2f %9.2fx %14.2f\n",
+                    build_size, hash, radix, hash / radix, parallel);
+    }
+    return sink == 42 ? 1 : 0;
+}
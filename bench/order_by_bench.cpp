@@ -0,0 +1,69 @@
+//
+// Top 100 of a million rows, by materializing the where output and sorting
+// it against order_by % take, over rows by score and over plain doubles.
+//
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bench.hpp"
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    struct row
+    {
+        int id;
+        double score;
+    };
+}
+
+int main()
+{
+    using namespace cinq;
+
+    const std::size_t rows = std::size_t{1} << 20;
+    const std::size_t k = 100;
+    std::mt19937_64 rng{42};
+    std::uniform_real_distribution<double> scores{0, 1};
+    std::vector<row> v(rows);
+    for (std::size_t i = 0; i < rows; ++i)
+        v[i] = {static_cast<int>(i), scores(rng)};
+    std::vector<double> d(rows);
+    for (auto& x : d)
+        x = scores(rng);
+
+    auto odd = [](const row& r) { return r.id % 2 != 0; };
+    auto by_score = [](const row& a, const row& b) { return a.score > b.score; };
+
+    std::printf("%-24s %12s %12s %10s\n", "", "sort ms", "top_k ms", "speedup");
+    double sink = 0;
+
+    auto sort_rows = bench::best_ms([&]
+    {
+        auto filtered = from(v) % where(odd);
+        std::vector<row> all(filtered.begin(), filtered.end());
+        std::sort(all.begin(), all.end(), by_score);
+        return all[k - 1].score;
+    }, sink);
+    auto top_rows = bench::best_ms([&]
+    {
+        return (from(v) % where(odd) % top_k(k, &row::score))[k - 1].score;
+    }, sink);
+    std::printf("%-24s %12.2f %12.2f %9.2fx\n", "rows, where, by score", sort_rows,
+                top_rows, sort_rows / top_rows);
+
+    auto sort_doubles = bench::best_ms([&]
+    {
+        std::vector<double> all(d);
+        std::sort(all.begin(), all.end(), [](double a, double b) { return a > b; });
+        return all[k - 1];
+    }, sink);
+    auto top_doubles = bench::best_ms([&]
+    {
+        return (d % top_k(k))[k - 1];
+    }, sink);
+    std::printf("%-24s %12.2f %12.2f %9.2fx\n", "doubles", sort_doubles,
+                top_doubles, sort_doubles / top_doubles);
+    return sink == 42 ? 1 : 0;
+}
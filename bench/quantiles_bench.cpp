@@ -0,0 +1,54 @@
+//
+// Median and tail percentiles of latencies, by copying into a vector and
+// calling std::nth_element against the one pass quantiles() sketch.
+//
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bench.hpp"
+#include "cinq/cinq.hpp"
+
+int main()
+{
+    using namespace cinq;
+
+    const std::vector<double> ranks = {0.5, 0.99, 0.999};
+    std::mt19937_64 rng{42};
+    std::lognormal_distribution<double> latency{0, 1};
+
+    std::printf("%10s %18s %16s %10s %14s\n", "rows", "nth_element ms",
+                "quantiles ms", "speedup", "Mvalues/s");
+    double sink = 0;
+    for (std::size_t rows : {std::size_t{1} << 16, std::size_t{1} << 20,
+                             std::size_t{1} << 24})
+    {
+        std::vector<double> v(rows);
+        for (auto& x : v)
+            x = latency(rng);
+
+        auto exact = bench::best_ms([&]
+        {
+            std::vector<double> copy(v);
+            double total = 0;
+            for (auto q : ranks)
+            {
+                auto nth = copy.begin() + static_cast<std::ptrdiff_t>(q * (rows - 1));
+                std::nth_element(copy.begin(), nth, copy.end());
+                total += *nth;
+            }
+            return total;
+        }, sink);
+        auto sketch = bench::best_ms([&]
+        {
+            double total = 0;
+            for (auto x : from(v) % quantiles(ranks))
+                total += x;
+            return total;
+        }, sink);
+
+        std::printf("%10zu %18.1f %16.1f %9.2fx %14.0f\n", rows, exact, sketch,
+                    exact / sketch, rows / sketch / 1e3);
+    }
+    return sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,251 @@
+//
+// Sum of contiguous ranges against std::accumulate, across element types and
+// sizes from L1-resident to memory-bound, then the same with a where stage
+// in front, which sum fuses into a masked loop, and the cost of compensated
+// floating point summation with sum<precise>, and 8 and 16-bit columns
+// summed into 64 bits with sum<std::int64_t>, and refreshing the sum of an
+// append-only buffer by rescanning it or with sum().incremental(). Reports
+// the kernel picked for the running CPU; the time per element is what
+// matters.
+//
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "bench.hpp"
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    const char* isa_name(cinq::detail::simd_isa isa)
+    {
+        switch (isa)
+        {
+        case cinq::detail::simd_isa::avx512: return "avx512";
+        case cinq::detail::simd_isa::avx2: return "avx2";
+        case cinq::detail::simd_isa::sse2: return "sse2";
+        default: return "scalar";
+        }
+    }
+
+    template <typename T>
+    double run(const char* type, std::mt19937_64& rng)
+    {
+        std::uniform_int_distribution<int> values{0, 100};
+        double total = 0;
+        for (std::size_t size = std::size_t{1} << 10;
+             size <= (std::size_t{1} << 24); size <<= 3)
+        {
+            std::vector<T> v(size);
+            for (auto& x : v)
+                x = static_cast<T>(values(rng));
+
+            const int runs = static_cast<int>(std::max<std::size_t>(
+                    (std::size_t{1} << 26) / size, 5));
+            T sink{};
+            auto accumulate = bench::best_ms([&]
+            {
+                return std::accumulate(v.begin(), v.end(), T{});
+            }, sink, runs);
+            auto sum = bench::best_ms([&]
+            {
+                return v % cinq::sum()();
+            }, sink, runs);
+
+            std::printf("%8s %10zu %16.3f %12.3f %9.2fx\n", type, size,
+                        accumulate * 1e6 / size, sum * 1e6 / size,
+                        accumulate / sum);
+            total += static_cast<double>(sink);
+        }
+        return total;
+    }
+
+    template <typename T>
+    double run_filtered(const char* type, std::mt19937_64& rng)
+    {
+        using namespace cinq;
+
+        std::uniform_int_distribution<int> values{0, 100};
+        auto below_half = [](T x) { return x < T{50}; };
+        double total = 0;
+        for (std::size_t size = std::size_t{1} << 10;
+             size <= (std::size_t{1} << 24); size <<= 3)
+        {
+            std::vector<T> v(size);
+            for (auto& x : v)
+                x = static_cast<T>(values(rng));
+
+            const int runs = static_cast<int>(std::max<std::size_t>(
+                    (std::size_t{1} << 26) / size, 5));
+            T sink{};
+            auto accumulate = bench::best_ms([&]
+            {
+                auto filtered = from(v) % where(below_half);
+                return std::accumulate(filtered.begin(), filtered.end(), T{});
+            }, sink, runs);
+            auto sum = bench::best_ms([&]
+            {
+                return from(v) % where(below_half) % cinq::sum()();
+            }, sink, runs);
+
+            std::printf("%8s %10zu %16.3f %12.3f %9.2fx\n", type, size,
+                        accumulate * 1e6 / size, sum * 1e6 / size,
+                        accumulate / sum);
+            total += static_cast<double>(sink);
+        }
+        return total;
+    }
+
+    template <typename T>
+    double run_precise(const char* type, std::mt19937_64& rng)
+    {
+        std::uniform_real_distribution<T> values{-1, 1};
+        double total = 0;
+        for (std::size_t size = std::size_t{1} << 10;
+             size <= (std::size_t{1} << 24); size <<= 3)
+        {
+            std::vector<T> v(size);
+            for (auto& x : v)
+                x = values(rng);
+
+            const int runs = static_cast<int>(std::max<std::size_t>(
+                    (std::size_t{1} << 26) / size, 5));
+            T sink{};
+            auto sum = bench::best_ms([&]
+            {
+                return v % cinq::sum()();
+            }, sink, runs);
+            auto precise = bench::best_ms([&]
+            {
+                return v % cinq::sum<cinq::precise>()();
+            }, sink, runs);
+
+            std::printf("%8s %10zu %16.3f %12.3f %9.2fx\n", type, size,
+                        sum * 1e6 / size, precise * 1e6 / size,
+                        precise / sum);
+            total += static_cast<double>(sink);
+        }
+        return total;
+    }
+
+    template <typename T>
+    double run_widening(const char* type, std::mt19937_64& rng)
+    {
+        std::uniform_int_distribution<int> values{
+                std::numeric_limits<T>::min(), std::numeric_limits<T>::max()};
+        double total = 0;
+        for (std::size_t size = std::size_t{1} << 10;
+             size <= (std::size_t{1} << 24); size <<= 3)
+        {
+            std::vector<T> v(size);
+            for (auto& x : v)
+                x = static_cast<T>(values(rng));
+
+            const int runs = static_cast<int>(std::max<std::size_t>(
+                    (std::size_t{1} << 26) / size, 5));
+            std::int64_t sink{};
+            auto accumulate = bench::best_ms([&]
+            {
+                return std::accumulate(v.begin(), v.end(), std::int64_t{});
+            }, sink, runs);
+            auto sum = bench::best_ms([&]
+            {
+                return v % cinq::sum<std::int64_t>()();
+            }, sink, runs);
+
+            std::printf("%8s %10zu %16.3f %12.3f %9.2fx\n", type, size,
+                        accumulate * 1e6 / size, sum * 1e6 / size,
+                        accumulate / sum);
+            total += static_cast<double>(sink);
+        }
+        return total;
+    }
+
+    // Appends of 1024 elements to a buffer with room for them, each followed
+    // by a refresh of its sum; times are per refresh, appends included.
+    double run_incremental(std::mt19937_64& rng)
+    {
+        const std::size_t appends = 64;
+        const std::size_t batch = 1024;
+        std::uniform_real_distribution<double> values{0, 100};
+        double total = 0;
+        for (std::size_t size = std::size_t{1} << 12;
+             size <= (std::size_t{1} << 24); size <<= 4)
+        {
+            std::vector<double> fresh(batch);
+            for (auto& x : fresh)
+                x = values(rng);
+            std::vector<double> rescanned(size, 1.0);
+            std::vector<double> buffer(size, 1.0);
+            rescanned.reserve(size + appends * batch);
+            buffer.reserve(size + appends * batch);
+            auto incremental = buffer % cinq::sum().incremental();
+            total += incremental();
+
+            double sink = 0;
+            auto rescan = bench::best_ms([&]
+            {
+                double last = 0;
+                for (std::size_t i = 0; i < appends; ++i)
+                {
+                    rescanned.insert(rescanned.end(), fresh.begin(), fresh.end());
+                    last = rescanned % cinq::sum()();
+                }
+                return last;
+            }, sink, 1);
+            auto refresh = bench::best_ms([&]
+            {
+                double last = 0;
+                for (std::size_t i = 0; i < appends; ++i)
+                {
+                    buffer.insert(buffer.end(), fresh.begin(), fresh.end());
+                    last = incremental();
+                }
+                return last;
+            }, sink, 1);
+
+            std::printf("%10zu %14.2f %16.2f %9.2fx\n", size,
+                        rescan * 1e3 / appends, refresh * 1e3 / appends,
+                        rescan / refresh);
+            total += sink;
+        }
+        return total;
+    }
+}
+
+int main()
+{
+    std::mt19937_64 rng{42};
+    std::printf("kernel: %s\n", isa_name(cinq::detail::simd_level()));
+    std::printf("%8s %10s %16s %12s %10s\n", "type", "elements",
+                "accumulate ns/el", "sum ns/el", "speedup");
+    double sink = run<float>("float", rng);
+    sink += run<double>("double", rng);
+    sink += run<std::int32_t>("int32", rng);
+    sink += run<std::int64_t>("int64", rng);
+
+    std::printf("\nwhere(x < 50) %% sum\n");
+    sink += run_filtered<float>("float", rng);
+    sink += run_filtered<double>("double", rng);
+    sink += run_filtered<std::int32_t>("int32", rng);
+    sink += run_filtered<std::int64_t>("int64", rng);
+
+    std::printf("\n%8s %10s %16s %12s %10s\n", "type", "elements",
+                "sum ns/el", "precise ns/el", "slowdown");
+    sink += run_precise<float>("float", rng);
+    sink += run_precise<double>("double", rng);
+
+    std::printf("\ninto int64\n");
+    sink += run_widening<std::uint8_t>("uint8", rng);
+    sink += run_widening<std::int8_t>("int8", rng);
+    sink += run_widening<std::uint16_t>("uint16", rng);
+    sink += run_widening<std::int16_t>("int16", rng);
+
+    std::printf("\n%10s %14s %16s %10s\n", "elements", "rescan us",
+                "incremental us", "speedup");
+    sink += run_incremental(rng);
+    return sink == 42 ? 1 : 0;
+}
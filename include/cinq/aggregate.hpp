@@ -0,0 +1,569 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <cinq/key.hpp>
+#include <cinq/simd.hpp>
+#include <cinq/sum.hpp>
+#include <cinq/where.hpp>
+
+namespace cinq {
+
+namespace detail
+{
+
+struct identity_key
+{
+    template <typename T>
+    const T& operator()(const T& value) const noexcept { return value; }
+};
+
+//
+// Aggregate functions of aggregate(). Each keeps a state_type<T> for
+// elements of type T, value-initialized when empty, folds elements into it
+// with add(), and turns it into its result with result<T>().
+//
+template <typename Selector, typename Mode>
+struct sum_aggregate
+{
+    template <typename T>
+    using accumulator = sum_accumulator<Mode, key_t<Selector, T>>;
+
+    template <typename T>
+    using state_type = typename accumulator<T>::type;
+
+    template <typename T>
+    void add(state_type<T>& state, const T& value) const
+    {
+        accumulator<T>::add(state, invoke_key(selector, value));
+    }
+
+    template <typename T>
+    auto result(const state_type<T>& state) const
+    {
+        return accumulator<T>::value(state);
+    }
+
+    Selector selector;
+};
+
+struct count_aggregate
+{
+    template <typename T>
+    using state_type = std::size_t;
+
+    template <typename T>
+    void add(std::size_t& state, const T&) const noexcept { ++state; }
+
+    template <typename T>
+    std::size_t result(std::size_t state) const noexcept { return state; }
+};
+
+// Whether a value compares unordered with itself, which only NaN does.
+template <typename T>
+std::enable_if_t<std::is_floating_point<T>::value, bool> is_nan(T value) noexcept
+{
+    return value != value;
+}
+
+template <typename T>
+std::enable_if_t<!std::is_floating_point<T>::value, bool> is_nan(const T&) noexcept
+{
+    return false;
+}
+
+// Smallest element, or largest with Greater, keeping the first of equal
+// ones. A NaN element makes the result NaN, as it does for sums. Empty
+// until the first element arrives.
+template <typename T>
+struct extreme_state
+{
+    T value{};
+    bool any = false;
+};
+
+template <typename Selector, bool Greater>
+struct extreme_aggregate
+{
+    template <typename T>
+    using state_type = extreme_state<key_t<Selector, T>>;
+
+    template <typename T>
+    void add(state_type<T>& state, const T& element) const
+    {
+        const auto& value = invoke_key(selector, element);
+        // Once NaN, the state compares unordered with, and so keeps over,
+        // any later value.
+        if (!state.any || is_nan(value) ||
+            (Greater ? state.value < value : value < state.value))
+        {
+            state.value = value;
+            state.any = true;
+        }
+    }
+
+    template <typename T>
+    key_t<Selector, T> result(const state_type<T>& state) const
+    {
+        if (!state.any)
+        {
+            throw std::out_of_range{Greater ? "cinq: max of an empty range"
+                                            : "cinq: min of an empty range"};
+        }
+        return state.value;
+    }
+
+    Selector selector;
+};
+
+// Integers are averaged from a 64-bit sum, as a double.
+template <typename T>
+using wide_sum_t = std::conditional_t<!std::is_integral<T>::value, T,
+        std::conditional_t<std::is_signed<T>::value, long long, unsigned long long>>;
+
+template <typename T>
+using average_t = std::conditional_t<std::is_integral<T>::value, double, T>;
+
+template <typename Mode, typename T>
+using average_accumulator = std::conditional_t<std::is_void<Mode>::value,
+        sum_accumulator<wide_sum_t<T>, T>, sum_accumulator<Mode, T>>;
+
+template <typename Selector, typename Mode>
+struct average_aggregate
+{
+    template <typename T>
+    using accumulator = average_accumulator<Mode, key_t<Selector, T>>;
+
+    template <typename T>
+    struct state_type
+    {
+        typename accumulator<T>::type sum{};
+        std::size_t count = 0;
+    };
+
+    template <typename T>
+    void add(state_type<T>& state, const T& element) const
+    {
+        accumulator<T>::add(state.sum, invoke_key(selector, element));
+        ++state.count;
+    }
+
+    template <typename T>
+    average_t<key_t<Selector, T>> result(const state_type<T>& state) const
+    {
+        using result_type = average_t<key_t<Selector, T>>;
+        if (state.count == 0)
+            throw std::out_of_range{"cinq: avg of an empty range"};
+        return static_cast<result_type>(accumulator<T>::value(state.sum)) /
+               static_cast<result_type>(state.count);
+    }
+
+    Selector selector;
+};
+
+// sum() of the elements themselves.
+template <typename Mode>
+sum_aggregate<identity_key, Mode> as_aggregate(const basic_summer_tag<Mode>&) noexcept
+{
+    return {};
+}
+
+template <typename Aggregate>
+const Aggregate& as_aggregate(const Aggregate& aggregate) noexcept
+{
+    return aggregate;
+}
+
+template <typename T, typename... Aggregates>
+using aggregate_states = std::tuple<typename Aggregates::template state_type<T>...>;
+
+template <typename T, typename... Aggregates, std::size_t... I>
+void add_aggregates(const std::tuple<Aggregates...>& aggregates,
+                    aggregate_states<T, Aggregates...>& states,
+                    const T& value, std::index_sequence<I...>)
+{
+    int expand[] = { 0, (std::get<I>(aggregates).add(std::get<I>(states), value), 0)... };
+    (void)expand;
+}
+
+template <typename T, typename... Aggregates, std::size_t... I>
+auto aggregate_results(const std::tuple<Aggregates...>& aggregates,
+                       const aggregate_states<T, Aggregates...>& states,
+                       std::index_sequence<I...>)
+{
+    return std::make_tuple(
+            std::get<I>(aggregates).template result<T>(std::get<I>(states))...);
+}
+
+//
+// Count, sum, smallest and largest of the elements of a contiguous range
+// that satisfy a predicate, in one branch-free pass: every lane folds in
+// its element or, if rejected, the identity of each operation. Integers
+// are summed in 64 bits. This serves every aggregate that only needs these
+// four values of the elements themselves. Any NaN kept makes both the
+// smallest and largest NaN, as extreme_aggregate does one at a time.
+//
+template <typename T>
+struct range_summary
+{
+    static constexpr T no_min = std::numeric_limits<T>::has_infinity
+            ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    static constexpr T no_max = std::numeric_limits<T>::has_infinity
+            ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+
+    std::size_t count = 0;
+    wide_sum_t<T> sum{};
+    T min = no_min;
+    T max = no_max;
+};
+
+template <typename T>
+constexpr T range_summary<T>::no_min;
+
+template <typename T>
+constexpr T range_summary<T>::no_max;
+
+template <typename T, std::size_t Lanes, typename Predicate>
+CINQ_SIMD_INLINE range_summary<T> summary_lanes(const T* p, std::size_t n,
+                                                const Predicate& pred)
+{
+    using wide_type = wide_sum_t<T>;
+    std::size_t count[Lanes] = {};
+    wide_type sum[Lanes] = {};
+    T min[Lanes];
+    T max[Lanes];
+    for (std::size_t lane = 0; lane < Lanes; ++lane)
+    {
+        min[lane] = range_summary<T>::no_min;
+        max[lane] = range_summary<T>::no_max;
+    }
+
+    std::size_t i = 0;
+    for (; i + Lanes <= n; i += Lanes)
+    {
+        for (std::size_t lane = 0; lane < Lanes; ++lane)
+        {
+            const T x = p[i + lane];
+            const bool keep = pred(x);
+            count[lane] += keep;
+            sum[lane] += select_if(keep, static_cast<wide_type>(x));
+            // Selected apart from the filter, or compilers branch on
+            // floating point comparisons.
+            const T lo = x < min[lane] ? x : min[lane];
+            const T hi = max[lane] < x ? x : max[lane];
+            min[lane] = keep ? lo : min[lane];
+            max[lane] = keep ? hi : max[lane];
+        }
+    }
+
+    range_summary<T> summary;
+    for (std::size_t lane = 0; lane < Lanes; ++lane)
+    {
+        summary.count += count[lane];
+        summary.sum += sum[lane];
+        summary.min = min[lane] < summary.min ? min[lane] : summary.min;
+        summary.max = summary.max < max[lane] ? max[lane] : summary.max;
+    }
+    for (; i < n; ++i)
+    {
+        const T x = p[i];
+        if (!pred(x))
+            continue;
+        ++summary.count;
+        summary.sum += x;
+        summary.min = x < summary.min ? x : summary.min;
+        summary.max = summary.max < x ? x : summary.max;
+    }
+    // A NaN kept turns the sum NaN, and so do infinities of both signs, so
+    // only then is the range searched for one, off the vector loop.
+    if (is_nan(summary.sum))
+    {
+        for (i = 0; i < n; ++i)
+        {
+            if (is_nan(p[i]) && pred(p[i]))
+            {
+                summary.min = summary.max = p[i];
+                break;
+            }
+        }
+    }
+    return summary;
+}
+
+template <typename T, typename Predicate>
+range_summary<T> summary_sse2(const T* p, std::size_t n, const Predicate& pred)
+{
+    return summary_lanes<T, 32 / sizeof(T)>(p, n, pred);
+}
+
+#if defined(CINQ_SIMD_X86)
+template <typename T, typename Predicate>
+CINQ_SIMD_TARGET("avx2")
+range_summary<T> summary_avx2(const T* p, std::size_t n, const Predicate& pred)
+{
+    return summary_lanes<T, 64 / sizeof(T)>(p, n, pred);
+}
+
+template <typename T, typename Predicate>
+CINQ_SIMD_TARGET("avx512f,avx512bw")
+range_summary<T> summary_avx512(const T* p, std::size_t n, const Predicate& pred)
+{
+    return summary_lanes<T, 128 / sizeof(T)>(p, n, pred);
+}
+#endif
+
+template <typename T, typename Predicate = keep_all>
+range_summary<T> summarize(const T* p, std::size_t n, const Predicate& pred = {},
+                           simd_isa isa = simd_level())
+{
+    switch (isa)
+    {
+#if defined(CINQ_SIMD_X86)
+    case simd_isa::avx512: return summary_avx512(p, n, pred);
+    case simd_isa::avx2: return summary_avx2(p, n, pred);
+#endif
+    default: return summary_sse2(p, n, pred);
+    }
+}
+
+//
+// Aggregates computed from a range_summary<T> by from_summary(), when over
+// the elements themselves and summed as they would be one at a time.
+//
+template <typename Aggregate>
+struct is_summarized : std::false_type {};
+
+template <>
+struct is_summarized<count_aggregate> : std::true_type {};
+
+template <>
+struct is_summarized<sum_aggregate<identity_key, void>> : std::true_type {};
+
+template <bool Greater>
+struct is_summarized<extreme_aggregate<identity_key, Greater>> : std::true_type {};
+
+template <>
+struct is_summarized<average_aggregate<identity_key, void>> : std::true_type {};
+
+template <typename T>
+std::size_t from_summary(const count_aggregate&, const range_summary<T>& summary)
+{
+    return summary.count;
+}
+
+// Integer sums wrap around as in the element type.
+template <typename T>
+T from_summary(const sum_aggregate<identity_key, void>&,
+               const range_summary<T>& summary)
+{
+    return static_cast<T>(summary.sum);
+}
+
+template <typename T, bool Greater>
+extreme_state<T> from_summary(const extreme_aggregate<identity_key, Greater>&,
+                              const range_summary<T>& summary)
+{
+    return {Greater ? summary.max : summary.min, summary.count != 0};
+}
+
+template <typename T>
+typename average_aggregate<identity_key, void>::template state_type<T>
+from_summary(const average_aggregate<identity_key, void>&,
+             const range_summary<T>& summary)
+{
+    return {summary.sum, summary.count};
+}
+
+template <typename T, typename... Aggregates, std::size_t... I>
+auto summary_results(const std::tuple<Aggregates...>& aggregates,
+                     const range_summary<T>& summary, std::index_sequence<I...>)
+{
+    return aggregate_results<T>(
+            aggregates,
+            aggregate_states<T, Aggregates...>{
+                    from_summary(std::get<I>(aggregates), summary)...},
+            std::index_sequence<I...>{});
+}
+
+template <typename... Conditions>
+struct all_of : std::true_type {};
+
+template <typename Condition, typename... Conditions>
+struct all_of<Condition, Conditions...>
+    : std::integral_constant<bool, Condition::value && all_of<Conditions...>::value> {};
+
+template <typename InputIterator, typename... Aggregates>
+auto aggregate_range(InputIterator begin, InputIterator end,
+                     const std::tuple<Aggregates...>& aggregates, std::false_type)
+{
+    using value_type = value_t<InputIterator>;
+    aggregate_states<value_type, Aggregates...> states;
+    for (; begin != end; ++begin)
+    {
+        const auto& value = *begin;
+        add_aggregates(aggregates, states, value,
+                       std::index_sequence_for<Aggregates...>{});
+    }
+    return aggregate_results<value_type>(aggregates, states,
+                                         std::index_sequence_for<Aggregates...>{});
+}
+
+template <typename InputIterator, typename... Aggregates>
+auto aggregate_range(InputIterator begin, InputIterator end,
+                     const std::tuple<Aggregates...>& aggregates, std::true_type)
+{
+    using value_type = value_t<InputIterator>;
+    const value_type* first = begin == end ? nullptr : contiguous_data(begin);
+    return summary_results(aggregates,
+                           summarize(first, static_cast<std::size_t>(end - begin)),
+                           std::index_sequence_for<Aggregates...>{});
+}
+
+template <typename Iterator, typename Predicate, typename... Aggregates>
+auto aggregate_range(where_iterator<Iterator, Predicate> begin,
+                     where_iterator<Iterator, Predicate> end,
+                     const std::tuple<Aggregates...>& aggregates, std::true_type)
+{
+    using value_type = value_t<Iterator>;
+    const value_type* first = begin == end ? nullptr : contiguous_data(begin.base());
+    const auto size = begin == end ? std::size_t{0} : static_cast<std::size_t>(
+            begin.base_end() - begin.base());
+    return summary_results(aggregates,
+                           summarize(first, size, begin.predicate()),
+                           std::index_sequence_for<Aggregates...>{});
+}
+
+template <typename Iterator, typename... Aggregates>
+using summarizable = std::integral_constant<bool,
+        is_contiguous<Iterator>::value &&
+        has_simd_sum<value_t<Iterator>>::value &&
+        all_of<is_summarized<Aggregates>...>::value>;
+
+template <typename InputIterator, typename... Aggregates>
+auto aggregate_range(InputIterator begin, InputIterator end,
+                     const std::tuple<Aggregates...>& aggregates)
+{
+    return aggregate_range(begin, end, aggregates,
+                           summarizable<InputIterator, Aggregates...>{});
+}
+
+// Where stages directly over contiguous ranges are summarized in a fused
+// masked loop, as sum() does.
+template <typename Iterator, typename Predicate, typename... Aggregates>
+auto aggregate_range(where_iterator<Iterator, Predicate> begin,
+                     where_iterator<Iterator, Predicate> end,
+                     const std::tuple<Aggregates...>& aggregates)
+{
+    return aggregate_range(begin, end, aggregates,
+                           summarizable<Iterator, Aggregates...>{});
+}
+
+}
+
+/**
+ * Sum of selector(element) over the elements of a group, in the
+ * accumulator of sum<Mode>(): sum<precise>(selector) compensates rounding
+ * errors, and sum<Acc>(selector) adds up in the arithmetic type Acc.
+ */
+template <typename Mode = void, typename Selector>
+detail::sum_aggregate<std::decay_t<Selector>, Mode> sum(Selector&& selector)
+{
+    return {std::forward<Selector>(selector)};
+}
+
+/**
+ * Number of elements of a group.
+ */
+constexpr
+detail::count_aggregate count() noexcept
+{
+    return {};
+}
+
+/**
+ * Smallest and largest selector(element) of a group, or of the elements
+ * themselves without a selector. Any NaN among floating point values makes
+ * the result NaN. Throw std::out_of_range on empty ranges.
+ */
+constexpr
+detail::extreme_aggregate<detail::identity_key, false> min() noexcept
+{
+    return {};
+}
+
+template <typename Selector>
+detail::extreme_aggregate<std::decay_t<Selector>, false> min(Selector&& selector)
+{
+    return {std::forward<Selector>(selector)};
+}
+
+constexpr
+detail::extreme_aggregate<detail::identity_key, true> max() noexcept
+{
+    return {};
+}
+
+template <typename Selector>
+detail::extreme_aggregate<std::decay_t<Selector>, true> max(Selector&& selector)
+{
+    return {std::forward<Selector>(selector)};
+}
+
+/**
+ * Arithmetic mean of selector(element), or of the elements themselves: a
+ * double for integers, summed in 64 bits, and of the element type for
+ * floating point. avg<Mode>() sums as sum<Mode>() does. Throws
+ * std::out_of_range on empty ranges.
+ */
+template <typename Mode = void>
+constexpr
+detail::average_aggregate<detail::identity_key, Mode> avg() noexcept
+{
+    return {};
+}
+
+template <typename Mode = void, typename Selector>
+detail::average_aggregate<std::decay_t<Selector>, Mode> avg(Selector&& selector)
+{
+    return {std::forward<Selector>(selector)};
+}
+
+template <typename... Aggregates>
+struct aggregate_closure
+{
+    std::tuple<Aggregates...> aggregates;
+};
+
+/**
+ * Aggregate functions computed together in a single pass, such as
+ * aggregate(sum(&order::amount), count()). sum() without a selector sums
+ * the elements themselves.
+ */
+template <typename... Aggregates>
+auto aggregate(const Aggregates&... aggregates)
+{
+    return aggregate_closure<std::decay_t<decltype(detail::as_aggregate(aggregates))>...>{
+            std::make_tuple(detail::as_aggregate(aggregates)...)};
+}
+
+/**
+ * Aggregates of a whole range, as a std::tuple of their results, computed
+ * in a single pass so that upstream stages such as where run once. When
+ * every aggregate is count(), sum(), min(), max() or avg() of the elements
+ * themselves, an arithmetic contiguous range, or a where stage over one,
+ * is summarized by one fused vector loop.
+ */
+template <typename Enumerable, typename... Aggregates>
+auto operator%(const Enumerable& range,
+               const aggregate_closure<Aggregates...>& closure)
+{
+    return detail::aggregate_range(std::cbegin(range), std::cend(range),
+                                   closure.aggregates);
+}
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cinq/enumerable.hpp>
+#include <cinq/key.hpp>
+#include <cinq/materialized_join.hpp>
+
+namespace cinq {
+
+namespace detail
+{
+
+//
+// Addresses of the elements of [begin, end) ordered by key. Inputs that are
+// already sorted are detected in a linear pass and not sorted again.
+//
+template <typename Iterator, typename Key>
+std::vector<const value_t<Iterator>*>
+sorted_by_key(Iterator begin, Iterator end, const Key& key)
+{
+    std::vector<const value_t<Iterator>*> items;
+    auto size = size_hint(begin, end);
+    if (size != npos_size)
+        items.reserve(size);
+    for (; begin != end; ++begin)
+        items.push_back(std::addressof(*begin));
+
+    auto less = [&key](const auto* lhs, const auto* rhs)
+    {
+        return invoke_key(key, *lhs) < invoke_key(key, *rhs);
+    };
+    if (!std::is_sorted(items.begin(), items.end(), less))
+        std::sort(items.begin(), items.end(), less);
+    return items;
+}
+
+}
+
+template <typename Enumerable, typename KeyA, typename KeyB, typename Width>
+struct join_on_band_closure
+{
+    const Enumerable& range;
+    KeyA key_a;
+    KeyB key_b;
+    Width width;
+};
+
+template <typename Enumerable, typename KeyA, typename Lower, typename Upper>
+struct join_on_interval_closure
+{
+    const Enumerable& range;
+    KeyA key_a;
+    Lower lower;
+    Upper upper;
+};
+
+/**
+ * Band join: rows (a, b) with |key_a(a) - key_b(b)| < width. Both inputs are
+ * ordered by key and swept with a window over the right input that only
+ * ever moves forward, for O((n + m) log(n + m) + output) work. Rows are
+ * materialized in the order of the left keys. Keys must be arithmetic.
+ */
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB, typename Width>
+auto operator%(const EnumerableFrom& range,
+               const join_on_band_closure<EnumerableJoinOn, KeyA, KeyB, Width>& join_on)
+{
+    using value_type1 = detail::value_t<decltype(std::cbegin(range))>;
+    using value_type2 = detail::value_t<decltype(std::cbegin(join_on.range))>;
+
+    auto left = detail::sorted_by_key(std::cbegin(range), std::cend(range),
+                                      join_on.key_a);
+    auto right = detail::sorted_by_key(std::cbegin(join_on.range),
+                                       std::cend(join_on.range),
+                                       join_on.key_b);
+
+    auto rows = std::make_shared<detail::joined_rows<value_type1, value_type2>>(1);
+    auto& out = rows->front();
+    const auto& width = join_on.width;
+    std::size_t window = 0;
+    for (const auto* a : left)
+    {
+        const auto key = detail::invoke_key(join_on.key_a, *a);
+        // Written without subtraction to stay correct for unsigned keys.
+        while (window < right.size() &&
+               !(detail::invoke_key(join_on.key_b, *right[window]) + width > key))
+            ++window;
+        for (auto j = window;
+             j < right.size() &&
+             detail::invoke_key(join_on.key_b, *right[j]) < key + width;
+             ++j)
+            out.emplace_back(a, right[j]);
+    }
+    return detail::materialized<value_type1, value_type2>(std::move(rows));
+}
+
+/**
+ * Interval join: rows (a, b) with lower(b) <= key_a(a) < upper(b). The left
+ * input is swept in key order while a min-heap on the upper bounds holds the
+ * right intervals open at the current key, for O((n + m) log(n + m) + output)
+ * work. Rows are materialized in the order of the left keys.
+ */
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename Lower, typename Upper>
+auto operator%(const EnumerableFrom& range,
+               const join_on_interval_closure<EnumerableJoinOn, KeyA, Lower, Upper>& join_on)
+{
+    using value_type1 = detail::value_t<decltype(std::cbegin(range))>;
+    using value_type2 = detail::value_t<decltype(std::cbegin(join_on.range))>;
+
+    auto left = detail::sorted_by_key(std::cbegin(range), std::cend(range),
+                                      join_on.key_a);
+    auto right = detail::sorted_by_key(std::cbegin(join_on.range),
+                                       std::cend(join_on.range),
+                                       join_on.lower);
+
+    auto ends_later = [&join_on](const value_type2* lhs, const value_type2* rhs)
+    {
+        return detail::invoke_key(join_on.upper, *rhs) <
+               detail::invoke_key(join_on.upper, *lhs);
+    };
+    std::vector<const value_type2*> open;
+
+    auto rows = std::make_shared<detail::joined_rows<value_type1, value_type2>>(1);
+    auto& out = rows->front();
+    std::size_t next = 0;
+    for (const auto* a : left)
+    {
+        const auto key = detail::invoke_key(join_on.key_a, *a);
+        for (; next < right.size() &&
+               !(key < detail::invoke_key(join_on.lower, *right[next]));
+             ++next)
+        {
+            open.push_back(right[next]);
+            std::push_heap(open.begin(), open.end(), ends_later);
+        }
+        while (!open.empty() &&
+               !(key < detail::invoke_key(join_on.upper, *open.front())))
+        {
+            std::pop_heap(open.begin(), open.end(), ends_later);
+            open.pop_back();
+        }
+        for (const auto* b : open)
+            out.emplace_back(a, b);
+    }
+    return detail::materialized<value_type1, value_type2>(std::move(rows));
+}
+
+}
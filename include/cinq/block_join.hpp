@@ -0,0 +1,329 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cinq/enumerable.hpp>
+#include <cinq/key.hpp>
+
+namespace cinq {
+
+namespace detail
+{
+
+// Left rows matched against each block of the right input, and right rows
+// per block: the block is revisited by every left row of the outer block,
+// so it is sized to stay in the L1 cache.
+constexpr std::size_t block_join_outer_rows = 256;
+constexpr std::size_t block_join_inner_rows = 1024;
+
+// Matches by evaluating an arbitrary predicate on every pair.
+template <typename Filter>
+struct predicate_block_matcher
+{
+    template <typename Iterator>
+    void load(Iterator, Iterator) {}
+
+    template <typename T1, typename Iterator>
+    void match(const T1& a, Iterator first, Iterator last,
+               std::vector<const value_t<Iterator>*>& matches)
+    {
+        for (; first != last; ++first)
+        {
+            if (filter(a, *first))
+                matches.push_back(std::addressof(*first));
+        }
+    }
+
+    Filter filter;
+};
+
+//
+// Matches compare(key_a(a), key_b(b)) for right elements of type T2. The
+// right keys of a block are copied into a contiguous array on
+// loading, so that the comparison against all of them is a branch-free loop
+// over plain values which the compiler turns into SIMD code for arithmetic
+// keys and the std comparison functors.
+//
+template <typename KeyA, typename Compare, typename KeyB, typename T2>
+struct compare_block_matcher
+{
+    using key_type = key_t<KeyB, T2>;
+
+    template <typename Iterator>
+    void load(Iterator first, Iterator last)
+    {
+        keys.clear();
+        items.clear();
+        for (; first != last; ++first)
+        {
+            keys.push_back(invoke_key(key_b, *first));
+            items.push_back(std::addressof(*first));
+        }
+        // Padded to whole words for the scan in match().
+        mask.resize((keys.size() + 7) / 8 * 8);
+    }
+
+    template <typename T1, typename Iterator>
+    void match(const T1& a, Iterator, Iterator,
+               std::vector<const T2*>& matches)
+    {
+        const auto key = invoke_key(key_a, a);
+        const key_type* k = keys.data();
+        unsigned char* m = mask.data();
+        const std::size_t n = keys.size();
+        for (std::size_t j = 0; j < n; ++j)
+            m[j] = compare(key, k[j]) ? 1 : 0;
+
+        // Skip eight comparisons at a time while none of them matched.
+        for (std::size_t j = 0; j < n; j += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, m + j, sizeof(word));
+            if (word == 0)
+                continue;
+            for (auto i = j; i < j + 8 && i < n; ++i)
+            {
+                if (m[i])
+                    matches.push_back(items[i]);
+            }
+        }
+    }
+
+    KeyA key_a;
+    Compare compare;
+    KeyB key_b;
+    std::vector<key_type> keys;
+    std::vector<const T2*> items;
+    std::vector<unsigned char> mask;
+};
+
+//
+// Progress of a block nested loop join, shared by the iterators over it:
+// the current outer block of left rows, the current inner block of right
+// rows [_inner, _inner_end), and the matches of the current left row within
+// the inner block.
+//
+template <typename InputIterator1, typename ForwardIterator2, typename Matcher>
+class block_join_state
+{
+public:
+    using value_type1 = value_t<InputIterator1>;
+    using value_type2 = value_t<ForwardIterator2>;
+
+public:
+    block_join_state(InputIterator1 begin1, InputIterator1 end1,
+                     ForwardIterator2 begin2, ForwardIterator2 end2,
+                     Matcher matcher)
+        : _it1{std::move(begin1)},
+          _end1{std::move(end1)},
+          _begin2{begin2},
+          _inner{begin2},
+          _inner_end{std::move(begin2)},
+          _end2{std::move(end2)},
+          _matcher{std::move(matcher)}
+    {
+        _outer.reserve(block_join_outer_rows);
+    }
+
+    void start()
+    {
+        if (next_outer() && next_inner())
+            seek();
+        else
+            finish();
+    }
+
+    void advance()
+    {
+        if (++_m < _matches.size())
+            return;
+        ++_a;
+        seek();
+    }
+
+    bool done() const noexcept { return _done; }
+
+    const value_type1& left_row() const noexcept { return *_outer[_a]; }
+    const value_type2& right_row() const noexcept { return *_matches[_m]; }
+
+private:
+    // Finds the first match from left row _a of the current blocks on,
+    // moving to further inner and then outer blocks as they run out.
+    void seek()
+    {
+        for (;;)
+        {
+            for (; _a < _outer.size(); ++_a)
+            {
+                _matches.clear();
+                _matcher.match(*_outer[_a], _inner, _inner_end, _matches);
+                if (!_matches.empty())
+                {
+                    _m = 0;
+                    return;
+                }
+            }
+            _a = 0;
+            if (next_inner())
+                continue;
+            if (next_outer())
+            {
+                _inner_end = _begin2;
+                if (next_inner())
+                    continue;
+            }
+            finish();
+            return;
+        }
+    }
+
+    bool next_outer()
+    {
+        _outer.clear();
+        for (; _it1 != _end1 && _outer.size() < block_join_outer_rows; ++_it1)
+            _outer.push_back(std::addressof(*_it1));
+        return !_outer.empty();
+    }
+
+    // Moves the inner block to the right elements following it.
+    bool next_inner()
+    {
+        _inner = _inner_end;
+        for (std::size_t n = 0;
+             _inner_end != _end2 && n < block_join_inner_rows; ++n)
+            ++_inner_end;
+        _matcher.load(_inner, _inner_end);
+        return _inner != _inner_end;
+    }
+
+    void finish()
+    {
+        _done = true;
+        _outer.clear();
+        _matches.clear();
+    }
+
+private:
+    InputIterator1 _it1;
+    InputIterator1 _end1;
+    ForwardIterator2 _begin2;
+    ForwardIterator2 _inner;
+    ForwardIterator2 _inner_end;
+    ForwardIterator2 _end2;
+    Matcher _matcher;
+    bool _done = false;
+
+    std::vector<const value_type1*> _outer;
+    std::vector<const value_type2*> _matches;
+    std::size_t _a = 0;
+    std::size_t _m = 0;
+};
+
+}
+
+/**
+ * block_join_iterator is a single-pass input iterator over the rows of a
+ * block nested loop join. All copies of an iterator share one position.
+ */
+template <typename InputIterator1, typename ForwardIterator2, typename Matcher>
+class block_join_iterator
+{
+public:
+    using state_type = detail::block_join_state<InputIterator1,
+                                                ForwardIterator2, Matcher>;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::pair<const typename state_type::value_type1&,
+                                 const typename state_type::value_type2&>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+public:
+    explicit block_join_iterator(std::shared_ptr<state_type> state = nullptr)
+        : _state{std::move(state)}
+    {}
+
+    block_join_iterator& operator++()
+    {
+        _state->advance();
+        return *this;
+    }
+
+    block_join_iterator operator++(int)
+    {
+        block_join_iterator tmp(*this);
+        operator++();
+        return tmp;
+    }
+
+    value_type operator*() const noexcept
+    {
+        return value_type{ _state->left_row(), _state->right_row() };
+    }
+
+    bool equal(const block_join_iterator& rhs) const
+    {
+        return at_end() ? rhs.at_end() : _state == rhs._state;
+    }
+
+private:
+    bool at_end() const noexcept { return !_state || _state->done(); }
+
+private:
+    std::shared_ptr<state_type> _state;
+};
+
+template <typename It1, typename It2, typename Matcher>
+bool operator==(const block_join_iterator<It1, It2, Matcher>& lhs,
+                const block_join_iterator<It1, It2, Matcher>& rhs)
+{
+    return lhs.equal(rhs);
+}
+
+template <typename It1, typename It2, typename Matcher>
+bool operator!=(const block_join_iterator<It1, It2, Matcher>& lhs,
+                const block_join_iterator<It1, It2, Matcher>& rhs)
+{
+    return !lhs.equal(rhs);
+}
+
+template <typename Enumerable, typename Matcher>
+struct block_join_closure
+{
+    const Enumerable& range;
+    Matcher matcher;
+};
+
+/**
+ * Block nested loop join: the left input is read in blocks of rows, and
+ * each block is matched against the right input one cache-sized block at a
+ * time, so the right input is scanned once per left block instead of once
+ * per left row. Rows come out grouped by left block, then by right block,
+ * then in left order. The right input must be a forward range, and both
+ * inputs must yield lvalues.
+ */
+template <typename EnumerableFrom, typename EnumerableJoinOn, typename Matcher>
+auto operator%(const EnumerableFrom& range,
+               const block_join_closure<EnumerableJoinOn, Matcher>& join_on)
+{
+    auto b1 = std::cbegin(range);
+    auto b2 = std::cbegin(join_on.range);
+    auto e1 = std::cend(range);
+    auto e2 = std::cend(join_on.range);
+
+    using iterator_type = block_join_iterator<decltype(b1), decltype(b2),
+                                              Matcher>;
+    auto state = std::make_shared<typename iterator_type::state_type>(
+            b1, e1, b2, e2, join_on.matcher);
+    state->start();
+
+    return enumerable<iterator_type>{ iterator_type{state}, iterator_type{} };
+}
+
+}
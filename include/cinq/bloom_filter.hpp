@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cinq
+{
+
+namespace detail
+{
+
+//
+// Split block Bloom filter: every key maps to one 256-bit block and sets one
+// bit in each of its eight 32-bit words, so a lookup reads a single block
+// that never straddles a cache line. At the default 16 bits per key the false
+// positive rate is about 0.3%.
+//
+class bloom_filter
+{
+public:
+    explicit bloom_filter(std::size_t expected, std::size_t bits_per_key = 16)
+    {
+        std::size_t blocks = (expected * bits_per_key + block_bits - 1) /
+                             block_bits;
+        _blocks = blocks > 0 ? blocks : 1;
+        // Over-allocate to align the first block on a cache line.
+        _storage.resize(_blocks * block_words + line_words);
+        auto address = reinterpret_cast<std::uintptr_t>(_storage.data());
+        auto skew = (line_bytes - address % line_bytes) % line_bytes;
+        _words = _storage.data() + skew / sizeof(std::uint32_t);
+    }
+
+    bloom_filter(const bloom_filter&) = delete;
+    bloom_filter& operator=(const bloom_filter&) = delete;
+
+    void insert(std::size_t hash) noexcept
+    {
+        auto* block = block_of(hash);
+        const auto key = static_cast<std::uint32_t>(hash);
+        for (int i = 0; i < block_words; ++i)
+            block[i] |= bit(key, i);
+    }
+
+    bool may_contain(std::size_t hash) const noexcept
+    {
+        const auto* block = block_of(hash);
+        const auto key = static_cast<std::uint32_t>(hash);
+        std::uint32_t missing = 0;
+        for (int i = 0; i < block_words; ++i)
+            missing |= bit(key, i) & ~block[i];
+        return missing == 0;
+    }
+
+private:
+    static constexpr int block_words = 8;
+    static constexpr std::size_t block_bits = block_words * 32;
+    static constexpr std::size_t line_bytes = 64;
+    static constexpr std::size_t line_words = line_bytes / sizeof(std::uint32_t);
+
+    static std::uint32_t bit(std::uint32_t key, int i) noexcept
+    {
+        static constexpr std::uint32_t salt[block_words] = {
+                0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+        return std::uint32_t{1} << ((key * salt[i]) >> 27);
+    }
+
+    // The block is chosen by the upper half of the hash, the bits within it
+    // by the lower half.
+    std::size_t index_of(std::size_t hash) const noexcept
+    {
+        auto upper = static_cast<std::uint64_t>(hash) >> 32;
+        return static_cast<std::size_t>((upper * _blocks) >> 32);
+    }
+
+    std::uint32_t* block_of(std::size_t hash) noexcept
+    {
+        return _words + index_of(hash) * block_words;
+    }
+
+    const std::uint32_t* block_of(std::size_t hash) const noexcept
+    {
+        return _words + index_of(hash) * block_words;
+    }
+
+private:
+    std::size_t _blocks;
+    std::vector<std::uint32_t> _storage;
+    std::uint32_t* _words;
+};
+
+}
+
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <cinq/bloom_filter.hpp>
+#include <cinq/enumerable.hpp>
+#include <cinq/hash_join.hpp>
+#include <cinq/hash_table.hpp>
+#include <cinq/key.hpp>
+#include <cinq/statistics.hpp>
+#include <cinq/where.hpp>
+
+namespace cinq {
+
+namespace detail
+{
+
+template <typename Key, typename KeyType>
+struct bloom_predicate
+{
+    std::shared_ptr<const bloom_filter> filter;
+    Key key;
+    join_statistics* stats;
+
+    template <typename T>
+    bool operator()(const T& value) const
+    {
+        bool pass = filter->may_contain(
+                hash_key<KeyType>(invoke_key(key, value)));
+        if (stats)
+        {
+            ++stats->bloom_checks;
+            stats->bloom_rejects += !pass;
+        }
+        return pass;
+    }
+};
+
+//
+// Adds filter to a pipeline as a where stage right above its source, below
+// the where stages it already has, so that rejected elements never reach
+// the other predicates.
+//
+template <typename Enumerable, typename Filter>
+auto push_down(const Enumerable& range, const Filter& filter)
+{
+    return range % where(Filter(filter));
+}
+
+template <typename Iterator, typename Predicate, typename Filter>
+auto push_down(const enumerable<where_iterator<Iterator, Predicate>>& range,
+               const Filter& filter)
+{
+    auto first = range.begin();
+    enumerable<Iterator> source{first.base_begin(), first.base_end()};
+    return push_down(source, filter) % where(Predicate(first.predicate()));
+}
+
+}
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class bloom_join_closure
+{
+public:
+    bloom_join_closure(join_on_keys_closure<Enumerable, KeyA, KeyB> keys,
+                       join_statistics* stats)
+        : _keys{std::move(keys)},
+          _stats{stats}
+    {}
+
+    const join_on_keys_closure<Enumerable, KeyA, KeyB>& keys() const noexcept
+    {
+        return _keys;
+    }
+
+    join_statistics* stats() const noexcept { return _stats; }
+
+private:
+    join_on_keys_closure<Enumerable, KeyA, KeyB> _keys;
+    join_statistics* _stats;
+};
+
+/**
+ * Hash join with Bloom filter pushdown. The table is always built over the
+ * joined range, together with a blocked Bloom filter of its keys; the filter
+ * is then pushed into the left pipeline beneath its where stages, so left
+ * elements without a possible match are dropped with a single cache line
+ * access before any other predicate or the table probe runs.
+ */
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB>
+auto operator%(const EnumerableFrom& range,
+               const bloom_join_closure<EnumerableJoinOn, KeyA, KeyB>& join_on)
+{
+    auto b2 = std::cbegin(join_on.keys().range());
+    auto e2 = std::cend(join_on.keys().range());
+
+    using value_type1 = detail::value_t<decltype(std::cbegin(range))>;
+    using value_type2 = detail::value_t<decltype(b2)>;
+    using key_type = std::common_type_t<detail::key_t<KeyA, value_type1>,
+                                        detail::key_t<KeyB, value_type2>>;
+
+    const auto key_b = join_on.keys().key_b();
+    auto size = detail::size_hint(b2, e2);
+    if (size == detail::npos_size)
+        size = static_cast<std::size_t>(std::distance(b2, e2));
+
+    detail::hash_table<const value_type2*> table{size};
+    auto filter = std::make_shared<detail::bloom_filter>(size);
+    for (auto it = b2; it != e2; ++it)
+    {
+        auto hash = detail::hash_key<key_type>(detail::invoke_key(key_b, *it));
+        table.insert(hash, std::addressof(*it));
+        filter->insert(hash);
+    }
+    if (join_on.stats())
+        join_on.stats()->build_rows += table.size();
+
+    auto probe = detail::push_down(
+            range,
+            detail::bloom_predicate<KeyA, key_type>{
+                    std::move(filter), join_on.keys().key_a(), join_on.stats()});
+
+    using iterator_type = hash_join_iterator<decltype(probe.begin()),
+                                             decltype(b2), KeyA, KeyB>;
+    using state_type = typename iterator_type::state_type;
+    auto state = std::make_shared<state_type>(join_on.keys().key_a(), key_b,
+                                              false);
+    state->table2 = std::make_shared<const decltype(table)>(std::move(table));
+
+    return enumerable<iterator_type>{
+        { probe.begin(), probe.end(), b2, e2, state },
+        { probe.end(), probe.end(), e2, e2, state }};
+}
+
+}
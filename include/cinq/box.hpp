@@ -0,0 +1,88 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cinq
+{
+
+namespace detail
+{
+
+//
+// Holder that makes copy-constructible types copy-assignable as well. Lambdas
+// have deleted assignment operators, so iterators that store one as a member
+// could not be assigned, which every algorithm rewinding an iterator needs.
+// Assignment of non-assignable types is done by destruction followed by copy
+// construction, which assumes that copy construction does not throw.
+//
+template <typename T, bool = std::is_copy_assignable<T>::value>
+class box
+{
+public:
+    box(T value)
+        : _value{std::move(value)}
+    {}
+
+    T& get() noexcept { return _value; }
+    const T& get() const noexcept { return _value; }
+
+private:
+    T _value;
+};
+
+template <typename T>
+class box<T, false>
+{
+public:
+    box(T value)
+    {
+        ::new (static_cast<void*>(std::addressof(_value))) T(std::move(value));
+    }
+
+    box(const box& rhs)
+        : box{rhs._value}
+    {}
+
+    box(box&& rhs)
+        : box{std::move(rhs._value)}
+    {}
+
+    box& operator=(const box& rhs)
+    {
+        if (this != &rhs)
+        {
+            _value.~T();
+            ::new (static_cast<void*>(std::addressof(_value))) T(rhs._value);
+        }
+        return *this;
+    }
+
+    box& operator=(box&& rhs)
+    {
+        if (this != &rhs)
+        {
+            _value.~T();
+            ::new (static_cast<void*>(std::addressof(_value)))
+                    T(std::move(rhs._value));
+        }
+        return *this;
+    }
+
+    ~box() { _value.~T(); }
+
+    T& get() noexcept { return _value; }
+    const T& get() const noexcept { return _value; }
+
+private:
+    union
+    {
+        T _value;
+    };
+};
+
+}
+
+}
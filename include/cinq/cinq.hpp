@@ -1,8 +1,17 @@
 #pragma once
 
+#include <cinq/aggregate.hpp>
 #include <cinq/enumerable.hpp>
 #include <cinq/from.hpp>
+#include <cinq/group_by.hpp>
+#include <cinq/hash_index.hpp>
+#include <cinq/hyperloglog.hpp>
 #include <cinq/join.hpp>
+#include <cinq/leapfrog_join.hpp>
+#include <cinq/left_join.hpp>
+#include <cinq/order_by.hpp>
+#include <cinq/quantiles.hpp>
+#include <cinq/semi_join.hpp>
 #include <cinq/sum.hpp>
 #include <cinq/where.hpp>
 
@@ -0,0 +1,645 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cinq/enumerable.hpp>
+#include <cinq/hash_join.hpp>
+#include <cinq/hash_table.hpp>
+#include <cinq/key.hpp>
+#include <cinq/partitioned_join.hpp>
+
+namespace cinq {
+
+namespace detail
+{
+
+// Bytes read from a spill file at a time.
+constexpr std::size_t spill_read_block_bytes = 64 * 1024;
+
+//
+// Anonymous temporary file, removed by the system once closed.
+//
+class spill_file
+{
+public:
+    spill_file()
+        : _file{std::tmpfile(), &std::fclose}
+    {
+        if (!_file)
+            throw std::runtime_error{"cinq: cannot create spill file"};
+    }
+
+    template <typename T>
+    void write(const T* data, std::size_t count)
+    {
+        if (count != 0 &&
+            std::fwrite(data, sizeof(T), count, _file.get()) != count)
+            throw std::runtime_error{"cinq: cannot write spill file"};
+    }
+
+    // Closes and removes the file.
+    void close() noexcept { _file.reset(); }
+
+    // Switches from writing to reading from the start.
+    void rewind()
+    {
+        if (std::fflush(_file.get()) != 0)
+            throw std::runtime_error{"cinq: cannot write spill file"};
+        std::rewind(_file.get());
+    }
+
+    // Reads up to count elements into out, replacing its contents. Bytes
+    // land in raw storage a block at a time and the elements are copy
+    // constructed from them, as they need not be trivially copyable.
+    template <typename T>
+    std::size_t read(std::vector<T>& out, std::size_t count)
+    {
+        using storage = std::aligned_storage_t<sizeof(T), alignof(T)>;
+        std::vector<storage> raw(std::min(
+                count, std::max<std::size_t>(spill_read_block_bytes / sizeof(T), 1)));
+        out.clear();
+        out.reserve(count);
+        while (out.size() < count)
+        {
+            auto n = std::min(raw.size(), count - out.size());
+            auto read = std::fread(raw.data(), sizeof(T), n, _file.get());
+            for (std::size_t i = 0; i < read; ++i)
+                out.push_back(*reinterpret_cast<const T*>(&raw[i]));
+            if (read != n)
+            {
+                if (std::ferror(_file.get()))
+                    throw std::runtime_error{"cinq: cannot read spill file"};
+                break;
+            }
+        }
+        return out.size();
+    }
+
+private:
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> _file;
+};
+
+//
+// Scatters elements by hash into one spill file per partition, through a
+// bounded write buffer per partition. Partitions are told apart by the hash
+// bits just below its top shift bits, which earlier partitioning consumed.
+//
+template <typename T>
+class spill_partitioner
+{
+public:
+    spill_partitioner(unsigned bits, unsigned shift, std::size_t buffer_rows)
+        : _bits{bits},
+          _shift{shift},
+          _buffer_rows{std::max<std::size_t>(buffer_rows, 1)},
+          _buffers(std::size_t{1} << bits),
+          _files(std::size_t{1} << bits),
+          _counts(std::size_t{1} << bits, 0)
+    {}
+
+    void add(std::size_t hash, const T& value)
+    {
+        auto p = radix_of(static_cast<std::uint64_t>(hash) << _shift, _bits);
+        _buffers[p].push_back(value);
+        ++_counts[p];
+        if (_buffers[p].size() == _buffer_rows)
+            flush(p);
+    }
+
+    std::vector<spill_file> finish()
+    {
+        for (std::size_t p = 0; p < _files.size(); ++p)
+        {
+            flush(p);
+            _files[p].rewind();
+        }
+        _buffers.clear();
+        return std::move(_files);
+    }
+
+    const std::vector<std::size_t>& counts() const noexcept { return _counts; }
+
+private:
+    void flush(std::size_t p)
+    {
+        _files[p].write(_buffers[p].data(), _buffers[p].size());
+        _buffers[p].clear();
+    }
+
+private:
+    unsigned _bits;
+    unsigned _shift;
+    std::size_t _buffer_rows;
+    std::vector<std::vector<T>> _buffers;
+    std::vector<spill_file> _files;
+    std::vector<std::size_t> _counts;
+};
+
+// Elements written to disk byte for byte and copy constructed back from the
+// bytes read. Trivial copy construction and destruction suffice: std::pair
+// of scalars qualifies, although its assignment is not trivial.
+template <typename T>
+using is_spillable = std::integral_constant<bool,
+        std::is_trivially_copy_constructible<T>::value &&
+        std::is_trivially_destructible<T>::value>;
+
+// Each spilled partition takes a file per input, and open files are limited.
+constexpr unsigned max_spill_bits = 8;
+
+// Top hash bits partitioning may consume, leaving the low ones that place
+// rows in hash tables. Rows sharing all of them, in practice rows of a
+// single key, always end up in one partition.
+constexpr unsigned max_spill_shift = 32;
+
+//
+// A pair of spilled partitions of the left and right inputs, holding the
+// rows whose hashes share their top shift bits.
+//
+struct spill_partition
+{
+    spill_file left;
+    spill_file right;
+    std::size_t right_rows;
+    unsigned shift;
+};
+
+template <typename T1, typename T2>
+std::vector<spill_partition> pair_partitions(spill_partitioner<T1>& left,
+                                             spill_partitioner<T2>& right,
+                                             unsigned shift)
+{
+    auto counts = right.counts();
+    auto left_files = left.finish();
+    auto right_files = right.finish();
+    std::vector<spill_partition> result;
+    result.reserve(counts.size());
+    for (std::size_t p = 0; p < counts.size(); ++p)
+    {
+        result.push_back({std::move(left_files[p]), std::move(right_files[p]),
+                          counts[p], shift});
+    }
+    return result;
+}
+
+template <typename Iterator>
+std::size_t count_remaining(Iterator begin, Iterator end,
+                            std::forward_iterator_tag)
+{
+    return static_cast<std::size_t>(std::distance(begin, end));
+}
+
+template <typename Iterator>
+std::size_t count_remaining(Iterator, Iterator, std::input_iterator_tag)
+{
+    return npos_size;
+}
+
+//
+// Progress of a grace hash join, shared by the iterators over it. The right
+// partition being joined is held in memory with its hash table, and the
+// matching left partition is read in chunks; without spilling there is a
+// single partition whose left side streams from the left input itself.
+// Spilled partitions wait on a stack, and one with more right rows than fit
+// the budget is split into smaller ones on further hash bits when taken.
+//
+template <typename InputIterator1, typename InputIterator2,
+          typename KeyA, typename KeyB>
+class grace_join_state
+{
+public:
+    using value_type1 = value_t<InputIterator1>;
+    using value_type2 = value_t<InputIterator2>;
+    using key_type = std::common_type_t<key_t<KeyA, value_type1>,
+                                        key_t<KeyB, value_type2>>;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+public:
+    grace_join_state(KeyA a, KeyB b, InputIterator1 begin1,
+                     InputIterator1 end1, std::size_t chunk_rows,
+                     std::size_t right_rows, std::size_t buffer_bytes)
+        : key_a{std::move(a)},
+          key_b{std::move(b)},
+          _it1{std::move(begin1)},
+          _end1{std::move(end1)},
+          _chunk_rows{std::max<std::size_t>(chunk_rows, 1)},
+          _right_rows{std::max<std::size_t>(right_rows, 1)},
+          _buffer_bytes{buffer_bytes}
+    {}
+
+    // Right rows held in memory; the operator fills them before start().
+    std::vector<value_type2>& right() noexcept { return _right; }
+
+    void spill(std::vector<spill_partition> partitions)
+    {
+        push(std::move(partitions));
+        _spilled = true;
+    }
+
+    void start()
+    {
+        if (_spilled)
+        {
+            if (!next_partition())
+            {
+                finish();
+                return;
+            }
+        }
+        else
+        {
+            build();
+        }
+        seek();
+    }
+
+    void advance()
+    {
+        if (match(_table.next(_hash, _slot)))
+            return;
+        ++_pos;
+        seek();
+    }
+
+    bool done() const noexcept { return _done; }
+
+    const value_type1& left_row() const noexcept { return _left[_pos]; }
+
+    const value_type2& right_row() const noexcept
+    {
+        return _right[_table.payload(_slot)];
+    }
+
+    KeyA key_a;
+    KeyB key_b;
+
+private:
+    void build()
+    {
+        _table = hash_table<std::uint32_t>{_right.size()};
+        for (std::size_t i = 0; i < _right.size(); ++i)
+        {
+            _table.insert(hash_key<key_type>(invoke_key(key_b, _right[i])),
+                          static_cast<std::uint32_t>(i));
+        }
+    }
+
+    // Finds the first match at or after _pos, loading further left chunks
+    // and partitions as needed.
+    void seek()
+    {
+        for (;;)
+        {
+            for (; _pos < _left.size(); ++_pos)
+            {
+                const key_type key = invoke_key(key_a, _left[_pos]);
+                _hash = hash_key(key);
+                if (match(_table.find(_hash)))
+                    return;
+            }
+            _pos = 0;
+            if (next_left_chunk() || next_partition())
+                continue;
+            finish();
+            return;
+        }
+    }
+
+    bool match(std::size_t slot)
+    {
+        const key_type key = invoke_key(key_a, _left[_pos]);
+        for (; slot != npos; slot = _table.next(_hash, slot))
+        {
+            if (invoke_key(key_b, _right[_table.payload(slot)]) == key)
+            {
+                _slot = slot;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool next_left_chunk()
+    {
+        _left.clear();
+        if (_spilled)
+        {
+            _pending.back().left.read(_left, _chunk_rows);
+        }
+        else
+        {
+            for (; _it1 != _end1 && _left.size() < _chunk_rows; ++_it1)
+                _left.push_back(*_it1);
+        }
+        return !_left.empty();
+    }
+
+    // Loads the next right partition with any rows, releasing the files of
+    // the previous one. Left partitions facing an empty right one are
+    // skipped, as they cannot produce rows.
+    bool next_partition()
+    {
+        if (!_spilled)
+            return false;
+        if (_loaded)
+        {
+            _pending.pop_back();
+            _loaded = false;
+        }
+        while (!_pending.empty())
+        {
+            auto& partition = _pending.back();
+            if (partition.right_rows == 0)
+            {
+                _pending.pop_back();
+                continue;
+            }
+            if (partition.right_rows > _right_rows &&
+                partition.shift < max_spill_shift)
+            {
+                split();
+                continue;
+            }
+            if (partition.right.read(_right, partition.right_rows) !=
+                partition.right_rows)
+                throw std::runtime_error{"cinq: cannot read spill file"};
+            build();
+            _loaded = true;
+            return true;
+        }
+        return false;
+    }
+
+    // Replaces the partition on top of the stack with enough partitions on
+    // the next hash bits for each right one to fit the budget.
+    void split()
+    {
+        auto parent = std::move(_pending.back());
+        _pending.pop_back();
+        _right = {};
+        _table = hash_table<std::uint32_t>{};
+
+        auto partitions = 2 * (parent.right_rows + _right_rows - 1) / _right_rows;
+        auto bits = std::min({ceil_log2(partitions), max_spill_bits,
+                              max_spill_shift - parent.shift});
+        spill_partitioner<value_type2> right_parts{
+                bits, parent.shift, (_buffer_bytes >> bits) / sizeof(value_type2)};
+        std::size_t right_rows = 0;
+        while (parent.right.read(_right, _right_rows) != 0)
+        {
+            right_rows += _right.size();
+            for (const auto& value : _right)
+                right_parts.add(hash_key<key_type>(invoke_key(key_b, value)), value);
+        }
+        if (right_rows != parent.right_rows)
+            throw std::runtime_error{"cinq: cannot read spill file"};
+        _right = {};
+        parent.right.close();
+
+        spill_partitioner<value_type1> left_parts{
+                bits, parent.shift, (_buffer_bytes >> bits) / sizeof(value_type1)};
+        while (parent.left.read(_left, _chunk_rows) != 0)
+        {
+            for (const auto& value : _left)
+                left_parts.add(hash_key<key_type>(invoke_key(key_a, value)), value);
+        }
+        _left = {};
+        parent.left.close();
+
+        push(pair_partitions(left_parts, right_parts, parent.shift + bits));
+    }
+
+    // Stacks partitions so that they are joined in order.
+    void push(std::vector<spill_partition> partitions)
+    {
+        std::move(partitions.rbegin(), partitions.rend(),
+                  std::back_inserter(_pending));
+    }
+
+    void finish()
+    {
+        _done = true;
+        _left = {};
+        _right = {};
+        _table = hash_table<std::uint32_t>{};
+        _pending.clear();
+    }
+
+private:
+    InputIterator1 _it1;
+    InputIterator1 _end1;
+    std::size_t _chunk_rows;
+    std::size_t _right_rows;
+    std::size_t _buffer_bytes;
+    bool _spilled = false;
+    bool _done = false;
+
+    // Partitions left to join; the one on top is being joined once loaded.
+    std::vector<spill_partition> _pending;
+    bool _loaded = false;
+
+    std::vector<value_type2> _right;
+    hash_table<std::uint32_t> _table;
+    std::vector<value_type1> _left;
+    std::size_t _pos = 0;
+    std::size_t _hash = 0;
+    std::size_t _slot = npos;
+};
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+constexpr std::size_t grace_join_state<It1, It2, KeyA, KeyB>::npos;
+
+}
+
+/**
+ * grace_join_iterator is a single-pass input iterator over the rows of a
+ * grace hash join. All copies of an iterator share one position, and the
+ * rows refer to copies of the input elements that stay valid only until the
+ * iterator is incremented.
+ */
+template <typename InputIterator1, typename InputIterator2,
+          typename KeyA, typename KeyB>
+class grace_join_iterator
+{
+public:
+    using state_type = detail::grace_join_state<InputIterator1, InputIterator2,
+                                                KeyA, KeyB>;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::pair<const typename state_type::value_type1&,
+                                 const typename state_type::value_type2&>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+public:
+    explicit grace_join_iterator(std::shared_ptr<state_type> state = nullptr)
+        : _state{std::move(state)}
+    {}
+
+    grace_join_iterator& operator++()
+    {
+        _state->advance();
+        return *this;
+    }
+
+    grace_join_iterator operator++(int)
+    {
+        grace_join_iterator tmp(*this);
+        operator++();
+        return tmp;
+    }
+
+    value_type operator*() const noexcept
+    {
+        return value_type{ _state->left_row(), _state->right_row() };
+    }
+
+    bool equal(const grace_join_iterator& rhs) const
+    {
+        return at_end() ? rhs.at_end() : _state == rhs._state;
+    }
+
+private:
+    bool at_end() const noexcept { return !_state || _state->done(); }
+
+private:
+    std::shared_ptr<state_type> _state;
+};
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator==(const grace_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const grace_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return lhs.equal(rhs);
+}
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator!=(const grace_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const grace_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return !lhs.equal(rhs);
+}
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class grace_join_closure
+{
+public:
+    grace_join_closure(join_on_keys_closure<Enumerable, KeyA, KeyB> keys,
+                       std::size_t memory_limit)
+        : _keys{std::move(keys)},
+          _memory_limit{memory_limit}
+    {}
+
+    const join_on_keys_closure<Enumerable, KeyA, KeyB>& keys() const noexcept
+    {
+        return _keys;
+    }
+
+    std::size_t memory_limit() const noexcept { return _memory_limit; }
+
+private:
+    join_on_keys_closure<Enumerable, KeyA, KeyB> _keys;
+    std::size_t _memory_limit;
+};
+
+/**
+ * Grace hash join within a memory budget. The joined range is read into
+ * memory while three quarters of the budget suffice for it and its hash
+ * table; the left input then streams through in chunks of the remaining
+ * quarter. Otherwise both inputs are hash-partitioned into temporary files,
+ * with enough partitions for each right partition to fit the budget, and
+ * partition pairs are joined one at a time. As at most 2^8 partitions are
+ * open at once, a pair whose right side is still beyond the budget is split
+ * again on further hash bits when its turn comes. Only rows whose hashes
+ * share their top 32 bits, in practice rows of one key, stay together and
+ * may exceed the budget.
+ *
+ * Elements are copied to disk byte for byte, so both element types must be
+ * trivially copy constructible and destructible. Rows come out partition by partition.
+ */
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB>
+auto operator%(const EnumerableFrom& range,
+               const grace_join_closure<EnumerableJoinOn, KeyA, KeyB>& join_on)
+{
+    auto b1 = std::cbegin(range);
+    auto b2 = std::cbegin(join_on.keys().range());
+    auto e1 = std::cend(range);
+    auto e2 = std::cend(join_on.keys().range());
+
+    using iterator_type = grace_join_iterator<decltype(b1), decltype(b2),
+                                              KeyA, KeyB>;
+    using state_type = typename iterator_type::state_type;
+    using value_type1 = typename state_type::value_type1;
+    using value_type2 = typename state_type::value_type2;
+    using key_type = typename state_type::key_type;
+    static_assert(detail::is_spillable<value_type1>::value &&
+                  detail::is_spillable<value_type2>::value,
+                  "grace join spills elements and requires trivially "
+                  "copyable types");
+
+    // Two table slots per right row at load factor 1/2.
+    constexpr std::size_t table_row_bytes = 2 * (sizeof(std::size_t) +
+                                                 sizeof(std::uint32_t));
+    const auto limit = join_on.memory_limit();
+    const auto right_rows = std::max<std::size_t>(
+            limit / 4 * 3 / (sizeof(value_type2) + table_row_bytes), 1);
+    const auto left_rows = limit / 4 / sizeof(value_type1);
+
+    const auto buffer_bytes = limit / 4;
+
+    auto state = std::make_shared<state_type>(join_on.keys().key_a(),
+                                              join_on.keys().key_b(),
+                                              b1, e1, left_rows, right_rows,
+                                              buffer_bytes);
+    auto& right = state->right();
+    for (; b2 != e2 && right.size() < right_rows; ++b2)
+        right.push_back(*b2);
+
+    if (b2 != e2)
+    {
+        auto remaining = detail::count_remaining(b2, e2,
+                typename std::iterator_traits<decltype(b2)>::iterator_category{});
+        auto partitions = remaining == detail::npos_size
+                ? std::size_t{64}
+                : 2 * (right.size() + remaining + right_rows - 1) / right_rows;
+        auto bits = std::min(detail::ceil_log2(partitions), detail::max_spill_bits);
+
+        detail::spill_partitioner<value_type2> right_parts{
+                bits, 0, (buffer_bytes >> bits) / sizeof(value_type2)};
+        for (const auto& value : right)
+        {
+            right_parts.add(detail::hash_key<key_type>(
+                    detail::invoke_key(state->key_b, value)), value);
+        }
+        right = {};
+        for (; b2 != e2; ++b2)
+        {
+            right_parts.add(detail::hash_key<key_type>(
+                    detail::invoke_key(state->key_b, *b2)), *b2);
+        }
+
+        detail::spill_partitioner<value_type1> left_parts{
+                bits, 0, (buffer_bytes >> bits) / sizeof(value_type1)};
+        for (; b1 != e1; ++b1)
+        {
+            left_parts.add(detail::hash_key<key_type>(
+                    detail::invoke_key(state->key_a, *b1)), *b1);
+        }
+
+        state->spill(detail::pair_partitions(left_parts, right_parts, bits));
+    }
+    state->start();
+
+    return enumerable<iterator_type>{ iterator_type{state}, iterator_type{} };
+}
+
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cinq/aggregate.hpp>
+#include <cinq/key.hpp>
+
+namespace cinq {
+
+namespace detail
+{
+
+//
+// Open-addressing table from distinct keys to their aggregate states, with
+// linear probing. Every slot holds the full hash, the key and the states
+// inline, so that the lookup and update of a group touch a single slot and
+// grouping allocates nothing per key. A stored hash of zero marks an empty
+// slot, as in hash_table; slots also record the order in which keys first
+// appeared.
+//
+template <typename Key, typename States>
+class group_table
+{
+public:
+    std::size_t size() const noexcept { return _size; }
+
+    States& find_or_insert(const Key& key)
+    {
+        auto hash = hash_key(key);
+        hash = hash != 0 ? hash : 1;
+        auto pos = hash & mask();
+        for (; _slots[pos].hash != 0; pos = (pos + 1) & mask())
+        {
+            if (_slots[pos].hash == hash && _slots[pos].key == key)
+                return _slots[pos].states;
+        }
+        if ((_size + 1) * 2 > _slots.size())
+        {
+            grow();
+            pos = free_slot(hash);
+        }
+        auto& slot = _slots[pos];
+        slot.hash = hash;
+        slot.order = _size++;
+        slot.key = key;
+        return slot.states;
+    }
+
+    // Calls fn(key, states) for every group, in order of first appearance,
+    // with the key as an rvalue.
+    template <typename Function>
+    void drain(Function fn)
+    {
+        std::vector<slot*> groups(_size);
+        for (auto& s : _slots)
+        {
+            if (s.hash != 0)
+                groups[s.order] = &s;
+        }
+        for (auto* s : groups)
+            fn(std::move(s->key), s->states);
+    }
+
+private:
+    struct slot
+    {
+        std::size_t hash = 0;
+        std::size_t order = 0;
+        Key key{};
+        States states{};
+    };
+
+    std::size_t mask() const noexcept { return _slots.size() - 1; }
+
+    std::size_t free_slot(std::size_t hash) const noexcept
+    {
+        auto pos = hash & mask();
+        while (_slots[pos].hash != 0)
+            pos = (pos + 1) & mask();
+        return pos;
+    }
+
+    void grow()
+    {
+        std::vector<slot> old(_slots.size() * 2);
+        old.swap(_slots);
+        for (auto& s : old)
+        {
+            if (s.hash != 0)
+                _slots[free_slot(s.hash)] = std::move(s);
+        }
+    }
+
+private:
+    // A few groups spread over a table far from full probe a single slot,
+    // which keeps the branch on finding the key predictable.
+    std::vector<slot> _slots = std::vector<slot>(1024);
+    std::size_t _size = 0;
+};
+
+}
+
+template <typename Key>
+struct group_by_closure
+{
+    Key key;
+};
+
+template <typename Key>
+group_by_closure<std::decay_t<Key>> group_by(Key&& key)
+{
+    return {std::forward<Key>(key)};
+}
+
+/**
+ * A range grouped by key, to be reduced per group by aggregate().
+ */
+template <typename Iterator, typename Key>
+struct grouping
+{
+    Iterator begin;
+    Iterator end;
+    Key key;
+};
+
+template <typename Enumerable, typename Key>
+auto operator%(const Enumerable& range, const group_by_closure<Key>& group)
+{
+    return grouping<decltype(std::cbegin(range)), Key>{
+            std::cbegin(range), std::cend(range), group.key};
+}
+
+/**
+ * Hash aggregation: one pass over the grouped range folds every element
+ * into the aggregate states of its key, then yields a std::vector of
+ * (key, std::tuple of aggregate results) pairs, one per distinct key in
+ * order of first appearance:
+ *
+ *     from(orders) % group_by(&order::customer) %
+ *             aggregate(sum(&order::amount), count())
+ */
+template <typename Iterator, typename Key, typename... Aggregates>
+auto operator%(const grouping<Iterator, Key>& group,
+               const aggregate_closure<Aggregates...>& closure)
+{
+    using value_type = detail::value_t<Iterator>;
+    using key_type = detail::key_t<Key, value_type>;
+    using states_type = detail::aggregate_states<value_type, Aggregates...>;
+    using indices = std::index_sequence_for<Aggregates...>;
+
+    detail::group_table<key_type, states_type> table;
+    for (auto it = group.begin; it != group.end; ++it)
+    {
+        const auto& value = *it;
+        detail::add_aggregates(closure.aggregates,
+                               table.find_or_insert(detail::invoke_key(group.key, value)),
+                               value, indices{});
+    }
+
+    using result_type = decltype(detail::aggregate_results<value_type>(
+            closure.aggregates, std::declval<const states_type&>(), indices{}));
+    std::vector<std::pair<key_type, result_type>> result;
+    result.reserve(table.size());
+    table.drain([&](key_type&& key, const states_type& states)
+    {
+        result.emplace_back(std::move(key),
+                            detail::aggregate_results<value_type>(
+                                    closure.aggregates, states, indices{}));
+    });
+    return result;
+}
+
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <cinq/enumerable.hpp>
+#include <cinq/hash_join.hpp>
+#include <cinq/hash_table.hpp>
+#include <cinq/key.hpp>
+
+namespace cinq {
+
+/**
+ * A hash table over a range, built once and then probed by any number of
+ * joins through join(index).on_key(key_a), which skip the build entirely.
+ *
+ * A built index is immutable, so it may be probed from several threads at
+ * once. It refers to the elements of the indexed range, which must outlive
+ * it and every join using it, and must not be modified or reallocated.
+ */
+template <typename Iterator, typename Key>
+class hash_index
+{
+public:
+    using iterator = Iterator;
+    using value_type = detail::value_t<Iterator>;
+    using key_type = detail::key_t<Key, value_type>;
+    using table_type = detail::hash_table<const value_type*>;
+
+public:
+    hash_index(Iterator begin, Iterator end, Key key)
+        : _begin{begin},
+          _end{end},
+          _key{std::move(key)},
+          _table{detail::build_table<key_type>(std::move(begin),
+                                               std::move(end), _key)}
+    {}
+
+    std::size_t size() const noexcept { return _table->size(); }
+
+    iterator begin() const noexcept { return _begin; }
+    iterator end() const noexcept { return _end; }
+    const Key& key() const noexcept { return _key; }
+    const std::shared_ptr<const table_type>& table() const noexcept
+    {
+        return _table;
+    }
+
+private:
+    Iterator _begin;
+    Iterator _end;
+    Key _key;
+    std::shared_ptr<const table_type> _table;
+};
+
+template <typename Container, typename Key>
+auto index(const Container& container, Key&& key)
+{
+    auto begin = std::cbegin(container);
+    return hash_index<decltype(begin), std::decay_t<Key>>{
+            begin, std::cend(container), std::forward<Key>(key)};
+}
+
+template <typename Iterator, typename Key, typename KeyA>
+class index_join_on_closure
+{
+public:
+    index_join_on_closure(const hash_index<Iterator, Key>& index, KeyA key_a)
+        : _index{index},
+          _key_a{std::move(key_a)}
+    {}
+
+    const hash_index<Iterator, Key>& index() const noexcept { return _index; }
+    KeyA key_a() const noexcept { return _key_a; }
+
+private:
+    const hash_index<Iterator, Key>& _index;
+    KeyA _key_a;
+};
+
+template <typename Iterator, typename Key>
+class index_join_closure
+{
+public:
+    index_join_closure(const hash_index<Iterator, Key>& index) noexcept
+        : _index{index}
+    {}
+
+    /**
+     * Equi-join of the keys extracted by key_a from the left input with the
+     * keys of the index, probing the prebuilt table.
+     */
+    template <typename KeyA>
+    index_join_on_closure<Iterator, Key, std::decay_t<KeyA>>
+    on_key(KeyA&& key_a) const
+    {
+        return {_index, std::forward<KeyA>(key_a)};
+    }
+
+private:
+    const hash_index<Iterator, Key>& _index;
+};
+
+template <typename Iterator, typename Key>
+index_join_closure<Iterator, Key> join(const hash_index<Iterator, Key>& index) noexcept
+{
+    return {index};
+}
+
+template <typename EnumerableFrom, typename Iterator, typename Key,
+          typename KeyA>
+auto operator%(const EnumerableFrom& range,
+               const index_join_on_closure<Iterator, Key, KeyA>& join_on)
+{
+    auto b1 = std::cbegin(range);
+    auto e1 = std::cend(range);
+    const auto& index = join_on.index();
+
+    using iterator_type = hash_join_iterator<decltype(b1), Iterator,
+                                             KeyA, Key>;
+    using state_type = typename iterator_type::state_type;
+    // Probes hash left keys as the common type of both keys, while the index
+    // was built hashing its own key type, so the two must be exactly the same.
+    static_assert(std::is_same<typename state_type::key_type,
+                               typename hash_index<Iterator, Key>::key_type>::value,
+                  "the common type of left and index keys must match the index key type exactly");
+
+    auto state = std::make_shared<state_type>(join_on.key_a(), index.key(),
+                                              false);
+    state->table2 = index.table();
+
+    return enumerable<iterator_type>{
+        { b1, e1, index.begin(), index.end(), state },
+        { e1, e1, index.end(), index.end(), state }};
+}
+
+}
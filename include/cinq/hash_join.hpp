@@ -0,0 +1,355 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <cinq/enumerable.hpp>
+#include <cinq/hash_table.hpp>
+#include <cinq/key.hpp>
+#include <cinq/parallel.hpp>
+
+namespace cinq {
+
+namespace detail
+{
+
+//
+// Hash table from key hashes to the addresses of the elements of
+// [begin, end), which must therefore yield lvalues. Keys are hashed as
+// KeyType so that both sides of a join agree on the hash of equal keys.
+//
+template <typename KeyType, typename Iterator, typename Key>
+std::shared_ptr<const hash_table<const value_t<Iterator>*>>
+build_table(Iterator begin, Iterator end, const Key& key)
+{
+    auto size = size_hint(begin, end);
+    hash_table<const value_t<Iterator>*> table{size != npos_size ? size : 0};
+    for (; begin != end; ++begin)
+    {
+        table.insert(hash_key<KeyType>(invoke_key(key, *begin)),
+                     std::addressof(*begin));
+    }
+    return std::make_shared<const hash_table<const value_t<Iterator>*>>(
+            std::move(table));
+}
+
+//
+// Immutable part of a hash join shared by all of its iterators: the hash
+// table over whichever input was chosen as the build side, and the key
+// extractors. Only one of the two tables is ever set. Tables are shared
+// rather than owned so that a prebuilt index can serve many joins.
+//
+template <typename InputIterator1, typename InputIterator2,
+          typename KeyA, typename KeyB>
+struct hash_join_state
+{
+    using value_type1 = value_t<InputIterator1>;
+    using value_type2 = value_t<InputIterator2>;
+    using key_type = std::common_type_t<key_t<KeyA, value_type1>,
+                                        key_t<KeyB, value_type2>>;
+
+    hash_join_state(KeyA a, KeyB b, bool left)
+        : key_a{std::move(a)},
+          key_b{std::move(b)},
+          build_left{left}
+    {}
+
+    KeyA key_a;
+    KeyB key_b;
+    bool build_left;
+    std::shared_ptr<const hash_table<const value_type1*>> table1;
+    std::shared_ptr<const hash_table<const value_type2*>> table2;
+};
+
+}
+
+/**
+ * hash_join_iterator is a single-pass input iterator over the rows of an
+ * equi-join. It walks the probe input once and, for every element, follows
+ * the matching probe sequence of the hash table built over the other input.
+ * Rows come out in the order of the probe input.
+ *
+ * The build input must yield lvalues, as the table stores element addresses.
+ */
+template <typename InputIterator1, typename InputIterator2,
+          typename KeyA, typename KeyB>
+class hash_join_iterator
+{
+public:
+    using state_type = detail::hash_join_state<InputIterator1, InputIterator2,
+                                               KeyA, KeyB>;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::pair<const typename state_type::value_type1&,
+                                 const typename state_type::value_type2&>;
+    using difference_type =
+            typename std::iterator_traits<InputIterator1>::difference_type;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+public:
+    hash_join_iterator(InputIterator1 begin1, InputIterator1 end1,
+                       InputIterator2 begin2, InputIterator2 end2,
+                       std::shared_ptr<const state_type> state)
+        // Only the probe side is walked; park the other one at its end so
+        // that begin and end iterators compare equal once probing is done.
+        : _it1{state->build_left ? end1 : std::move(begin1)},
+          _end1{std::move(end1)},
+          _it2{state->build_left ? std::move(begin2) : end2},
+          _end2{std::move(end2)},
+          _state{std::move(state)}
+    {
+        if (_state->build_left)
+            seek(_it2, _end2, *_state->table1, _state->key_b, _state->key_a);
+        else
+            seek(_it1, _end1, *_state->table2, _state->key_a, _state->key_b);
+    }
+
+    // Iterator over no rows, positioned at the given ends. It needs no
+    // table and must not be dereferenced or incremented.
+    hash_join_iterator(InputIterator1 end1, InputIterator2 end2)
+        : _it1{end1},
+          _end1{std::move(end1)},
+          _it2{end2},
+          _end2{std::move(end2)}
+    {}
+
+    hash_join_iterator& operator++()
+    {
+        if (_state->build_left)
+            advance(_it2, _end2, *_state->table1, _state->key_b, _state->key_a);
+        else
+            advance(_it1, _end1, *_state->table2, _state->key_a, _state->key_b);
+        return *this;
+    }
+
+    hash_join_iterator operator++(int)
+    {
+        hash_join_iterator tmp(*this);
+        operator++();
+        return tmp;
+    }
+
+    value_type operator*() const noexcept
+    {
+        if (_state->build_left)
+            return value_type{ *_state->table1->payload(_slot), *_it2 };
+        return value_type{ *_it1, *_state->table2->payload(_slot) };
+    }
+
+    bool equal(const hash_join_iterator& rhs) const
+    {
+        return _it1 == rhs._it1 && _it2 == rhs._it2 && _slot == rhs._slot;
+    }
+
+private:
+    using key_type = typename state_type::key_type;
+
+    // Moves to the next slot matching the current probe element, or to the
+    // first match of a following probe element.
+    template <typename Iterator, typename Table, typename ProbeKey,
+              typename BuildKey>
+    void advance(Iterator& it, const Iterator& end, const Table& table,
+                 const ProbeKey& probe_key, const BuildKey& build_key)
+    {
+        const key_type key = detail::invoke_key(probe_key, *it);
+        if (match(table, key, table.next(_hash, _slot), build_key))
+            return;
+        seek(++it, end, table, probe_key, build_key);
+    }
+
+    // Finds the first match at or after it.
+    template <typename Iterator, typename Table, typename ProbeKey,
+              typename BuildKey>
+    void seek(Iterator& it, const Iterator& end, const Table& table,
+              const ProbeKey& probe_key, const BuildKey& build_key)
+    {
+        for (; it != end; ++it)
+        {
+            const key_type key = detail::invoke_key(probe_key, *it);
+            _hash = detail::hash_key(key);
+            if (match(table, key, table.find(_hash), build_key))
+                return;
+        }
+        _slot = npos;
+    }
+
+    template <typename Table, typename BuildKey>
+    bool match(const Table& table, const key_type& key, std::size_t pos,
+               const BuildKey& build_key)
+    {
+        for (; pos != Table::npos; pos = table.next(_hash, pos))
+        {
+            if (detail::invoke_key(build_key, *table.payload(pos)) == key)
+            {
+                _slot = pos;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    InputIterator1 _it1;
+    InputIterator1 _end1;
+    InputIterator2 _it2;
+    InputIterator2 _end2;
+    std::size_t _hash = 0;
+    std::size_t _slot = npos;
+    std::shared_ptr<const state_type> _state;
+};
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+constexpr std::size_t hash_join_iterator<It1, It2, KeyA, KeyB>::npos;
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator==(const hash_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const hash_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return lhs.equal(rhs);
+}
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator!=(const hash_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const hash_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return !lhs.equal(rhs);
+}
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class partitioned_join_closure;
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class parallel_join_closure;
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class bloom_join_closure;
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class grace_join_closure;
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class row_id_join_closure;
+
+struct join_statistics;
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class join_on_keys_closure
+{
+public:
+    join_on_keys_closure(const Enumerable& range, KeyA key_a, KeyB key_b)
+        : _range{range},
+          _key_a{std::move(key_a)},
+          _key_b{std::move(key_b)}
+    {}
+
+    const Enumerable& range() const noexcept { return _range; }
+    KeyA key_a() const noexcept { return _key_a; }
+    KeyB key_b() const noexcept { return _key_b; }
+
+    /**
+     * Runs the join radix-partitioned on 2^radix_bits partitions, or on as
+     * many as needed for build partitions to fit in cache when zero. See
+     * partitioned_join.hpp.
+     */
+    partitioned_join_closure<Enumerable, KeyA, KeyB>
+    partitioned(unsigned radix_bits = 0) const
+    {
+        return {*this, radix_bits};
+    }
+
+    /**
+     * Runs the join on all workers of the given pool, or of the shared
+     * pool. See parallel_join.hpp.
+     */
+    parallel_join_closure<Enumerable, KeyA, KeyB> parallel() const
+    {
+        return {*this, thread_pool::shared()};
+    }
+
+    parallel_join_closure<Enumerable, KeyA, KeyB>
+    parallel(thread_pool& pool) const
+    {
+        return {*this, pool};
+    }
+
+    /**
+     * Builds a Bloom filter over the joined range's keys and pushes it down
+     * into the left pipeline, optionally reporting the achieved filter rate
+     * in stats. See bloom_join.hpp.
+     */
+    bloom_join_closure<Enumerable, KeyA, KeyB>
+    bloom(join_statistics* stats = nullptr) const
+    {
+        return {*this, stats};
+    }
+
+    /**
+     * Grace hash join that keeps its working memory within about
+     * memory_limit bytes by spilling partitions of both inputs to temporary
+     * files. See grace_join.hpp.
+     */
+    grace_join_closure<Enumerable, KeyA, KeyB>
+    grace(std::size_t memory_limit) const
+    {
+        return {*this, memory_limit};
+    }
+
+    /**
+     * Yields the positions of joined elements in random access inputs
+     * instead of the elements. See row_id_join.hpp.
+     */
+    row_id_join_closure<Enumerable, KeyA, KeyB> row_ids() const
+    {
+        return row_id_join_closure<Enumerable, KeyA, KeyB>{*this};
+    }
+
+private:
+    const Enumerable& _range;
+    KeyA _key_a;
+    KeyB _key_b;
+};
+
+/**
+ * Hash join. The table is built over the smaller input when both sizes are
+ * known in constant time (random access iterators), and over the joined
+ * range otherwise; the other input is then probed in a single pass.
+ */
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB>
+auto operator%(const EnumerableFrom& range,
+               const join_on_keys_closure<EnumerableJoinOn, KeyA, KeyB>& join_on)
+{
+    auto b1 = std::cbegin(range);
+    auto b2 = std::cbegin(join_on.range());
+    auto e1 = std::cend(range);
+    auto e2 = std::cend(join_on.range());
+
+    using iterator_type = hash_join_iterator<decltype(b1), decltype(b2),
+                                             KeyA, KeyB>;
+    using state_type = typename iterator_type::state_type;
+
+    using key_type = typename state_type::key_type;
+
+    auto size1 = detail::size_hint(b1, e1);
+    auto size2 = detail::size_hint(b2, e2);
+    bool build_left = size1 != detail::npos_size &&
+                      size2 != detail::npos_size &&
+                      size1 < size2;
+
+    auto state = std::make_shared<state_type>(
+            join_on.key_a(), join_on.key_b(), build_left);
+    if (build_left)
+        state->table1 = detail::build_table<key_type>(b1, e1, state->key_a);
+    else
+        state->table2 = detail::build_table<key_type>(b2, e2, state->key_b);
+
+    return enumerable<iterator_type>{
+        { b1, e1, b2, e2, state },
+        { e1, e1, e2, e2, state }};
+}
+
+}
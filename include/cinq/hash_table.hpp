@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <cinq/key.hpp>
+
+namespace cinq
+{
+
+namespace detail
+{
+
+//
+// Open-addressing multimap from precomputed hashes to payloads, with linear
+// probing and no deletion. Equal keys simply occupy consecutive slots of the
+// same probe sequence, so duplicates need no separate chaining. Key equality
+// is left to the caller: find() and next() only filter on the full hash,
+// which is stored in the slot so that most mismatches never touch the
+// payload.
+//
+// A stored hash of zero marks an empty slot, hence hashes are remapped away
+// from zero on insertion and lookup.
+//
+template <typename Payload>
+class hash_table
+{
+public:
+    using payload_type = Payload;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+public:
+    explicit hash_table(std::size_t expected = 0)
+    {
+        std::size_t capacity = 16;
+        while (capacity < expected * 2)
+            capacity *= 2;
+        _slots.resize(capacity);
+    }
+
+    std::size_t size() const noexcept { return _size; }
+    std::size_t capacity() const noexcept { return _slots.size(); }
+
+    void insert(std::size_t hash, Payload payload)
+    {
+        if ((_size + 1) * 2 > _slots.size())
+            grow();
+        place(stored(hash), std::move(payload));
+        ++_size;
+    }
+
+    // Position of the first slot holding the given hash, or npos.
+    std::size_t find(std::size_t hash) const noexcept
+    {
+        hash = stored(hash);
+        return scan(hash, hash & mask());
+    }
+
+    // Position of the next slot after pos holding the given hash, or npos.
+    std::size_t next(std::size_t hash, std::size_t pos) const noexcept
+    {
+        return scan(stored(hash), (pos + 1) & mask());
+    }
+
+    const Payload& payload(std::size_t pos) const noexcept
+    {
+        return _slots[pos].payload;
+    }
+
+private:
+    struct slot
+    {
+        std::size_t hash = 0;
+        Payload payload{};
+    };
+
+    static std::size_t stored(std::size_t hash) noexcept
+    {
+        return hash != 0 ? hash : 1;
+    }
+
+    std::size_t mask() const noexcept { return _slots.size() - 1; }
+
+    std::size_t scan(std::size_t hash, std::size_t pos) const noexcept
+    {
+        for (; _slots[pos].hash != 0; pos = (pos + 1) & mask())
+        {
+            if (_slots[pos].hash == hash)
+                return pos;
+        }
+        return npos;
+    }
+
+    void place(std::size_t hash, Payload payload)
+    {
+        auto pos = hash & mask();
+        while (_slots[pos].hash != 0)
+            pos = (pos + 1) & mask();
+        _slots[pos].hash = hash;
+        _slots[pos].payload = std::move(payload);
+    }
+
+    void grow()
+    {
+        std::vector<slot> old(_slots.size() * 2);
+        old.swap(_slots);
+        for (auto& s : old)
+        {
+            if (s.hash != 0)
+                place(s.hash, std::move(s.payload));
+        }
+    }
+
+private:
+    std::vector<slot> _slots;
+    std::size_t _size = 0;
+};
+
+template <typename Payload>
+constexpr std::size_t hash_table<Payload>::npos;
+
+//
+// Set of distinct keys on top of hash_table, for operators that only need
+// to know whether a key occurs.
+//
+template <typename Key>
+class key_set
+{
+public:
+    explicit key_set(std::size_t expected = 0)
+        : _table{expected}
+    {}
+
+    std::size_t size() const noexcept { return _table.size(); }
+
+    void insert(const Key& key)
+    {
+        auto hash = hash_key(key);
+        if (!contains(key, hash))
+            _table.insert(hash, key);
+    }
+
+    bool contains(const Key& key) const
+    {
+        return contains(key, hash_key(key));
+    }
+
+private:
+    bool contains(const Key& key, std::size_t hash) const
+    {
+        for (auto pos = _table.find(hash); pos != _table.npos;
+             pos = _table.next(hash, pos))
+        {
+            if (_table.payload(pos) == key)
+                return true;
+        }
+        return false;
+    }
+
+private:
+    hash_table<Key> _table;
+};
+
+}
+
+}
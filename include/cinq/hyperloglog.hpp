@@ -0,0 +1,355 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cinq/key.hpp>
+#include <cinq/simd.hpp>
+
+namespace cinq {
+
+namespace detail
+{
+
+inline unsigned leading_zeros(std::uint64_t x) noexcept
+{
+#if defined(__GNUC__)
+    return x == 0 ? 64 : static_cast<unsigned>(__builtin_clzll(x));
+#else
+    unsigned n = 0;
+    for (std::uint64_t bit = std::uint64_t{1} << 63; bit != 0 && !(x & bit); bit >>= 1)
+        ++n;
+    return n;
+#endif
+}
+
+//
+// Hashes of sketch keys, fixed so that sketches built by different programs,
+// platforms or standard libraries merge: integers hash by value whatever
+// their type, floating point values by the bits of their double, and
+// strings by 64-bit FNV-1a over their bytes, each finished by the
+// MurmurHash3 finalizer. Other keys fall back to std::hash, whose values
+// are only stable within one standard library.
+//
+inline std::uint64_t sketch_mix(std::uint64_t x) noexcept
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+inline std::uint64_t sketch_hash(const char* data, std::size_t size) noexcept
+{
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 0x100000001b3ULL;
+    }
+    return sketch_mix(h);
+}
+
+template <typename T>
+std::enable_if_t<std::is_integral<T>::value, std::uint64_t> sketch_hash(T value) noexcept
+{
+    return sketch_mix(static_cast<std::uint64_t>(value));
+}
+
+template <typename T>
+std::enable_if_t<std::is_floating_point<T>::value, std::uint64_t> sketch_hash(T value) noexcept
+{
+    // Zeros of both signs are equal, and so hash alike.
+    double d = value == 0 ? 0.0 : static_cast<double>(value);
+    std::uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return sketch_mix(bits);
+}
+
+template <typename Traits, typename Allocator>
+std::uint64_t sketch_hash(const std::basic_string<char, Traits, Allocator>& value) noexcept
+{
+    return sketch_hash(value.data(), value.size());
+}
+
+inline std::uint64_t sketch_hash(const char* value) noexcept
+{
+    return sketch_hash(value, std::strlen(value));
+}
+
+// Without it, the generic overload below would hash these by address.
+inline std::uint64_t sketch_hash(char* value) noexcept
+{
+    return sketch_hash(value, std::strlen(value));
+}
+
+template <typename T>
+std::enable_if_t<!std::is_arithmetic<T>::value, std::uint64_t> sketch_hash(const T& value)
+{
+    return hash_key(value);
+}
+
+// dst[i] = max(dst[i], src[i]) over n registers, a vector at a time.
+template <std::size_t Bytes>
+CINQ_SIMD_INLINE void max_registers_lanes(std::uint8_t* dst, const std::uint8_t* src,
+                                          std::size_t n) noexcept
+{
+    std::size_t i = 0;
+#if defined(CINQ_SIMD_VECTORS)
+    using V = simd_t<std::uint8_t, Bytes>;
+    V a, b;
+    for (; i + Bytes <= n; i += Bytes)
+    {
+        simd_load(a, dst + i);
+        simd_load(b, src + i);
+        a = a < b ? b : a;
+        std::memcpy(dst + i, &a, sizeof(a));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = dst[i] < src[i] ? src[i] : dst[i];
+}
+
+inline void max_registers_sse2(std::uint8_t* dst, const std::uint8_t* src,
+                               std::size_t n) noexcept
+{
+    max_registers_lanes<16>(dst, src, n);
+}
+
+#if defined(CINQ_SIMD_X86)
+CINQ_SIMD_TARGET("avx2")
+inline void max_registers_avx2(std::uint8_t* dst, const std::uint8_t* src,
+                               std::size_t n) noexcept
+{
+    max_registers_lanes<32>(dst, src, n);
+}
+
+CINQ_SIMD_TARGET("avx512f,avx512bw")
+inline void max_registers_avx512(std::uint8_t* dst, const std::uint8_t* src,
+                                 std::size_t n) noexcept
+{
+    max_registers_lanes<64>(dst, src, n);
+}
+#endif
+
+inline void max_registers(std::uint8_t* dst, const std::uint8_t* src,
+                          std::size_t n, simd_isa isa = simd_level()) noexcept
+{
+    switch (isa)
+    {
+#if defined(CINQ_SIMD_X86)
+    case simd_isa::avx512: return max_registers_avx512(dst, src, n);
+    case simd_isa::avx2: return max_registers_avx2(dst, src, n);
+#endif
+    default: return max_registers_sse2(dst, src, n);
+    }
+}
+
+}
+
+/**
+ * HyperLogLog sketch of a set of hashes, estimating its number of distinct
+ * elements within about 1.04 / sqrt(2^precision) relative standard error
+ * (0.8% at the default precision of 14) in 2^precision bytes, however large
+ * the set. The first precision bits of a hash pick a register, which keeps
+ * the highest rank, one plus the number of leading zeros, of the remaining
+ * bits seen. Small cardinalities are estimated by linear counting.
+ *
+ * Sketches of the same precision merge into the sketch of the union of
+ * their sets, so partial sketches can be built per thread or shard, and
+ * serialize to a compact byte string for storage. add() hashes integers,
+ * floating point values and strings with a fixed function, so sketches of
+ * these merge across programs and platforms; other keys are hashed with
+ * std::hash, and their sketches only merge within one standard library.
+ */
+class hyperloglog
+{
+public:
+    static constexpr unsigned min_precision = 4;
+    static constexpr unsigned max_precision = 18;
+
+public:
+    explicit hyperloglog(unsigned precision = 14)
+        : _precision{checked(precision)},
+          _registers(std::size_t{1} << precision)
+    {}
+
+    unsigned precision() const noexcept { return _precision; }
+    const std::vector<std::uint8_t>& registers() const noexcept { return _registers; }
+
+    // Adds a well-mixed 64-bit hash, such as those of detail::sketch_hash.
+    void add_hash(std::uint64_t hash) noexcept
+    {
+        const auto index = static_cast<std::size_t>(hash >> (64 - _precision));
+        const auto rest = hash << _precision;
+        const auto rank = static_cast<std::uint8_t>(
+                rest == 0 ? 65 - _precision : detail::leading_zeros(rest) + 1);
+        if (_registers[index] < rank)
+            _registers[index] = rank;
+    }
+
+    template <typename T>
+    void add(const T& value)
+    {
+        add_hash(detail::sketch_hash(value));
+    }
+
+    // Turns this sketch into that of the union with other, which must have
+    // the same precision.
+    void merge(const hyperloglog& other)
+    {
+        if (other._precision != _precision)
+            throw std::invalid_argument{"cinq: merging hyperloglog sketches of different precision"};
+        detail::max_registers(_registers.data(), other._registers.data(),
+                              _registers.size());
+    }
+
+    double estimate() const noexcept
+    {
+        const auto m = static_cast<double>(_registers.size());
+        double sum = 0;
+        std::size_t zeros = 0;
+        for (auto r : _registers)
+        {
+            sum += std::ldexp(1.0, -static_cast<int>(r));
+            zeros += r == 0;
+        }
+        const double raw = alpha() * m * m / sum;
+        if (raw <= 2.5 * m && zeros != 0)
+            return m * std::log(m / static_cast<double>(zeros));
+        return raw;
+    }
+
+    /**
+     * A format version byte, the precision byte, then the registers.
+     */
+    std::vector<std::uint8_t> serialize() const
+    {
+        std::vector<std::uint8_t> bytes;
+        bytes.reserve(2 + _registers.size());
+        bytes.push_back(std::uint8_t{format_version});
+        bytes.push_back(static_cast<std::uint8_t>(_precision));
+        bytes.insert(bytes.end(), _registers.begin(), _registers.end());
+        return bytes;
+    }
+
+    static hyperloglog deserialize(const std::uint8_t* data, std::size_t size)
+    {
+        if (size < 2 || data[0] != format_version ||
+            data[1] < min_precision || data[1] > max_precision ||
+            size != 2 + (std::size_t{1} << data[1]))
+            throw std::invalid_argument{"cinq: malformed hyperloglog sketch"};
+        hyperloglog sketch{data[1]};
+        const auto max_rank = 65 - sketch._precision;
+        for (std::size_t i = 0; i < sketch._registers.size(); ++i)
+        {
+            if (data[2 + i] > max_rank)
+                throw std::invalid_argument{"cinq: malformed hyperloglog sketch"};
+            sketch._registers[i] = data[2 + i];
+        }
+        return sketch;
+    }
+
+    static hyperloglog deserialize(const std::vector<std::uint8_t>& bytes)
+    {
+        return deserialize(bytes.data(), bytes.size());
+    }
+
+    friend bool operator==(const hyperloglog& lhs, const hyperloglog& rhs)
+    {
+        return lhs._precision == rhs._precision && lhs._registers == rhs._registers;
+    }
+
+    friend bool operator!=(const hyperloglog& lhs, const hyperloglog& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    static constexpr std::uint8_t format_version = 1;
+
+    static unsigned checked(unsigned precision)
+    {
+        if (precision < min_precision || precision > max_precision)
+            throw std::invalid_argument{"cinq: hyperloglog precision out of range"};
+        return precision;
+    }
+
+    double alpha() const noexcept
+    {
+        switch (_precision)
+        {
+        case 4: return 0.673;
+        case 5: return 0.697;
+        case 6: return 0.709;
+        default: return 0.7213 / (1 + 1.079 / static_cast<double>(_registers.size()));
+        }
+    }
+
+private:
+    unsigned _precision;
+    std::vector<std::uint8_t> _registers;
+};
+
+template <typename Key>
+struct hyperloglog_closure
+{
+    Key key;
+    unsigned precision;
+};
+
+template <typename Key>
+struct count_distinct_approx_closure
+{
+    hyperloglog_closure<Key> sketch;
+};
+
+/**
+ * HyperLogLog sketch of the keys of a range, to be merged with others or
+ * stored.
+ */
+template <typename Key>
+hyperloglog_closure<std::decay_t<Key>> distinct_sketch(Key&& key,
+                                                       unsigned precision = 14)
+{
+    return {std::forward<Key>(key), precision};
+}
+
+/**
+ * Estimated number of distinct keys of a range, from a HyperLogLog sketch
+ * of the given precision (see hyperloglog).
+ */
+template <typename Key>
+count_distinct_approx_closure<std::decay_t<Key>>
+count_distinct_approx(Key&& key, unsigned precision = 14)
+{
+    return {{std::forward<Key>(key), precision}};
+}
+
+template <typename Enumerable, typename Key>
+hyperloglog operator%(const Enumerable& range, const hyperloglog_closure<Key>& closure)
+{
+    hyperloglog sketch{closure.precision};
+    auto end = std::cend(range);
+    for (auto it = std::cbegin(range); it != end; ++it)
+        sketch.add(detail::invoke_key(closure.key, *it));
+    return sketch;
+}
+
+template <typename Enumerable, typename Key>
+std::uint64_t operator%(const Enumerable& range,
+                        const count_distinct_approx_closure<Key>& closure)
+{
+    return static_cast<std::uint64_t>(std::llround((range % closure.sketch).estimate()));
+}
+
+}
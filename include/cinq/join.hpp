@@ -1,7 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <iterator>
+#include <type_traits>
+#include <cinq/band_join.hpp>
+#include <cinq/block_join.hpp>
+#include <cinq/bloom_join.hpp>
+#include <cinq/box.hpp>
 #include <cinq/enumerable.hpp>
+#include <cinq/grace_join.hpp>
+#include <cinq/hash_join.hpp>
+#include <cinq/key.hpp>
+#include <cinq/merge_join.hpp>
+#include <cinq/parallel_join.hpp>
+#include <cinq/partitioned_join.hpp>
+#include <cinq/row_id_join.hpp>
 
 namespace cinq {
 
@@ -13,10 +27,10 @@ class join_iterator
 {
 public:
     using iterator_category = std::input_iterator_tag;
-    using value_type = std::pair<const typename InputIterator1::value_type&,
-                                 const typename InputIterator2::value_type&>;
-    //using difference_type = typename iterator_type::difference_type;
-    using difference_type = typename InputIterator1::difference_type;
+    using value_type = std::pair<const detail::value_t<InputIterator1>&,
+                                 const detail::value_t<InputIterator2>&>;
+    using difference_type =
+            typename std::iterator_traits<InputIterator1>::difference_type;
     using pointer = value_type*;
     using reference = value_type&;
 
@@ -29,19 +43,14 @@ public:
           _it1{std::move(begin1)},
           _it2{std::move(begin2)},
           _filter{std::move(filter)}
-    {}
+    {
+        seek();
+    }
 
     join_iterator& operator++()
     {
-        for (; _it1 != _range1.end(); ++_it1)
-        {
-            for (++_it2; _it2 != _range2.end(); ++_it2)
-            {
-                if (_filter(*_it1, *_it2))
-                    return *this;
-            }
-            _it2 = _range2.begin();
-        }
+        ++_it2;
+        seek();
         return *this;
     }
 
@@ -64,7 +73,24 @@ public:
 
     bool equal(const join_iterator& rhs) const
     {
-        return _it1 == rhs._it1 || _it2 == rhs._it2;
+        return _it1 == rhs._it1 && _it2 == rhs._it2;
+    }
+
+private:
+    // Positions on the first matching pair at or after (_it1, _it2), or on
+    // (end1, end2) when there is none.
+    void seek()
+    {
+        for (; _it1 != _range1.end(); ++_it1)
+        {
+            for (; _it2 != _range2.end(); ++_it2)
+            {
+                if (_filter.get()(*_it1, *_it2))
+                    return;
+            }
+            _it2 = _range2.begin();
+        }
+        _it2 = _range2.end();
     }
 
 private:
@@ -72,7 +98,7 @@ private:
     enumerable<InputIterator2> _range2;
     InputIterator1 _it1;
     InputIterator2 _it2;
-    Filter _filter;
+    detail::box<Filter> _filter;
 };
 
 template <typename It1, typename It2, typename Filter>
@@ -101,11 +127,193 @@ public:
     const Enumerable& range() const noexcept { return _range; }
     Filter filter() const noexcept { return _filter; }
 
+    /**
+     * Runs the join as a block nested loop join. See block_join.hpp.
+     */
+    block_join_closure<Enumerable, detail::predicate_block_matcher<Filter>>
+    blocked() const
+    {
+        return {_range, {_filter}};
+    }
+
 private:
     const Enumerable& _range;
     Filter _filter;
 };
 
+/**
+ * Join strategies for join(...).on(key_a, key_b). The automatic choice is
+ * a merge join when the inputs are declared sorted, a nested loop join when
+ * either input is known to hold at most nested_loop_join_max elements, and
+ * a hash join otherwise.
+ *
+ * Only the strategies the key type supports are compiled: a merge join
+ * needs keys ordered by operator<, and a hash join needs keys std::hash
+ * accepts. A choice or hint the keys do not support falls back to a hash
+ * join, then to a nested loop join, which only compares keys with ==.
+ */
+enum class join_hint
+{
+    automatic,
+    nested_loop,
+    hash,
+    merge
+};
+
+namespace detail
+{
+
+// Largest input for which the automatic choice prefers comparing every pair
+// to hashing: a few key comparisons per element of the other input are
+// cheaper than hashing it and building a table.
+constexpr std::size_t nested_loop_join_max = 8;
+
+inline join_hint choose_join(std::size_t size1, std::size_t size2,
+                             bool sorted, join_hint hint) noexcept
+{
+    if (hint != join_hint::automatic)
+        return hint;
+    if (sorted)
+        return join_hint::merge;
+    // npos_size is the largest size_t, so unknown sizes never qualify.
+    if (std::min(size1, size2) <= nested_loop_join_max)
+        return join_hint::nested_loop;
+    return join_hint::hash;
+}
+
+inline join_hint choose_join(std::size_t size1, std::size_t size2,
+                             bool sorted, join_hint hint,
+                             bool hashable, bool ordered) noexcept
+{
+    auto strategy = choose_join(size1, size2, sorted, hint);
+    if (strategy == join_hint::merge && !ordered)
+        strategy = join_hint::hash;
+    if (strategy == join_hint::hash && !hashable)
+        strategy = join_hint::nested_loop;
+    return strategy;
+}
+
+// Equality of extracted keys, as the filter of a nested loop join.
+template <typename KeyA, typename KeyB, typename KeyType>
+struct key_equal
+{
+    template <typename T1, typename T2>
+    bool operator()(const T1& a, const T2& b) const
+    {
+        return KeyType(invoke_key(key_a, a)) == invoke_key(key_b, b);
+    }
+
+    KeyA key_a;
+    KeyB key_b;
+};
+
+//
+// The hash and merge joins behind join(...).on(key_a, key_b), run when
+// chosen and parked at the ends of the inputs otherwise. Strategies the key
+// type does not support are never instantiated: their iterators are those
+// of the nested loop join, always parked.
+//
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB, typename Parked>
+auto auto_hash_join(std::true_type, bool chosen, const EnumerableFrom& range,
+                    const EnumerableJoinOn& joined, const KeyA& key_a,
+                    const KeyB& key_b, const Parked&)
+{
+    auto e1 = std::cend(range);
+    auto e2 = std::cend(joined);
+    using iterator_type = hash_join_iterator<decltype(e1), decltype(e2),
+                                             KeyA, KeyB>;
+    const auto parked = enumerable<iterator_type>{{e1, e2}, {e1, e2}};
+    return chosen
+            ? range % join_on_keys_closure<EnumerableJoinOn, KeyA, KeyB>{
+                      joined, key_a, key_b}
+            : parked;
+}
+
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB, typename Parked>
+Parked auto_hash_join(std::false_type, bool, const EnumerableFrom&,
+                      const EnumerableJoinOn&, const KeyA&, const KeyB&,
+                      const Parked& parked)
+{
+    return parked;
+}
+
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB, typename Parked>
+auto auto_merge_join(std::true_type, bool chosen, const EnumerableFrom& range,
+                     const EnumerableJoinOn& joined, const KeyA& key_a,
+                     const KeyB& key_b, const Parked&)
+{
+    auto e1 = std::cend(range);
+    auto e2 = std::cend(joined);
+    using iterator_type = merge_join_iterator<decltype(e1), decltype(e2),
+                                              KeyA, KeyB>;
+    const auto parked = enumerable<iterator_type>{
+            {e1, e1, e2, e2, key_a, key_b}, {e1, e1, e2, e2, key_a, key_b}};
+    return chosen
+            ? range % join_on_sorted_closure<EnumerableJoinOn, KeyA, KeyB>{
+                      joined, key_a, key_b}
+            : parked;
+}
+
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB, typename Parked>
+Parked auto_merge_join(std::false_type, bool, const EnumerableFrom&,
+                       const EnumerableJoinOn&, const KeyA&, const KeyB&,
+                       const Parked& parked)
+{
+    return parked;
+}
+
+}
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class join_on_auto_closure
+{
+public:
+    join_on_auto_closure(const Enumerable& range, KeyA key_a, KeyB key_b)
+        : _range{range},
+          _key_a{std::move(key_a)},
+          _key_b{std::move(key_b)}
+    {}
+
+    const Enumerable& range() const noexcept { return _range; }
+    const KeyA& key_a() const noexcept { return _key_a; }
+    const KeyB& key_b() const noexcept { return _key_b; }
+    bool is_sorted() const noexcept { return _sorted; }
+    join_hint strategy() const noexcept { return _hint; }
+
+    /**
+     * Declares both inputs sorted ascending by their keys, which makes the
+     * merge join the automatic choice.
+     */
+    join_on_auto_closure sorted() const
+    {
+        auto result = *this;
+        result._sorted = true;
+        return result;
+    }
+
+    /**
+     * Overrides the automatic choice. A merge join still requires both
+     * inputs to be sorted by their keys.
+     */
+    join_on_auto_closure hint(join_hint strategy) const
+    {
+        auto result = *this;
+        result._hint = strategy;
+        return result;
+    }
+
+private:
+    const Enumerable& _range;
+    KeyA _key_a;
+    KeyB _key_b;
+    bool _sorted = false;
+    join_hint _hint = join_hint::automatic;
+};
+
 template <typename Enumerable>
 class join_closure
 {
@@ -115,11 +323,90 @@ public:
     {}
 
     template <typename Filter>
-    join_on_closure<Enumerable, Filter> on(Filter&& filter) const noexcept
+    join_on_closure<Enumerable, std::decay_t<Filter>> on(Filter&& filter) const
     {
         return {_range, std::forward<Filter>(filter)};
     }
 
+    /**
+     * Equi-join on the keys extracted by key_a from the left input and by
+     * key_b from this range, leaving the choice of algorithm to the join:
+     * see join_hint. Rows come out in an order that depends on the choice.
+     */
+    template <typename KeyA, typename KeyB>
+    join_on_auto_closure<Enumerable, std::decay_t<KeyA>, std::decay_t<KeyB>>
+    on(KeyA&& key_a, KeyB&& key_b) const
+    {
+        return {_range, std::forward<KeyA>(key_a), std::forward<KeyB>(key_b)};
+    }
+
+    /**
+     * Equi-join on the keys extracted by key_a from the left input and by
+     * key_b from this range, executed as a hash join. Either extractor may be
+     * a callable or a pointer to data member.
+     */
+    template <typename KeyA, typename KeyB>
+    join_on_keys_closure<Enumerable, std::decay_t<KeyA>, std::decay_t<KeyB>>
+    on_keys(KeyA&& key_a, KeyB&& key_b) const
+    {
+        return {_range, std::forward<KeyA>(key_a), std::forward<KeyB>(key_b)};
+    }
+
+    /**
+     * Equi-join of inputs that are already sorted ascending by key_a and
+     * key_b respectively, executed as a merge join in a single pass over
+     * both inputs and without allocation.
+     */
+    template <typename KeyA, typename KeyB>
+    join_on_sorted_closure<Enumerable, std::decay_t<KeyA>, std::decay_t<KeyB>>
+    on_sorted(KeyA&& key_a, KeyB&& key_b) const
+    {
+        return {_range, std::forward<KeyA>(key_a), std::forward<KeyB>(key_b)};
+    }
+
+    /**
+     * Join matching compare(key_a(a), key_b(b)), executed as a block nested
+     * loop join that compares every left key against a block of right keys
+     * at once. With arithmetic keys and a std comparison functor such as
+     * std::less<>, the comparison loop is vectorized.
+     */
+    template <typename KeyA, typename Compare, typename KeyB>
+    block_join_closure<Enumerable, detail::compare_block_matcher<
+            std::decay_t<KeyA>, std::decay_t<Compare>, std::decay_t<KeyB>,
+            detail::value_t<decltype(std::cbegin(std::declval<const Enumerable&>()))>>>
+    on_compare(KeyA&& key_a, Compare&& compare, KeyB&& key_b) const
+    {
+        return {_range, {std::forward<KeyA>(key_a),
+                         std::forward<Compare>(compare),
+                         std::forward<KeyB>(key_b), {}, {}, {}}};
+    }
+
+    /**
+     * Band join matching |key_a(a) - key_b(b)| < width, executed by sorting
+     * both inputs (unless already sorted) and sweeping a window.
+     */
+    template <typename KeyA, typename KeyB, typename Width>
+    join_on_band_closure<Enumerable, std::decay_t<KeyA>, std::decay_t<KeyB>,
+                         Width>
+    on_band(KeyA&& key_a, KeyB&& key_b, Width width) const
+    {
+        return {_range, std::forward<KeyA>(key_a), std::forward<KeyB>(key_b),
+                width};
+    }
+
+    /**
+     * Interval join matching lower(b) <= key_a(a) < upper(b), executed as a
+     * sweep over both inputs in key order.
+     */
+    template <typename KeyA, typename Lower, typename Upper>
+    join_on_interval_closure<Enumerable, std::decay_t<KeyA>,
+                             std::decay_t<Lower>, std::decay_t<Upper>>
+    on_interval(KeyA&& key_a, Lower&& lower, Upper&& upper) const
+    {
+        return {_range, std::forward<KeyA>(key_a), std::forward<Lower>(lower),
+                std::forward<Upper>(upper)};
+    }
+
 private:
     const Enumerable& _range;
 };
@@ -144,4 +431,159 @@ auto operator%(const EnumerableFrom& range,
         { b1, e1, b2, e2, join_on.filter() },
         { e1, e1, e2, e2, join_on.filter() }};
 }
+
+/**
+ * auto_join_iterator is a single-pass input iterator over the rows of an
+ * equi-join executed by the strategy chosen for it. It carries an iterator
+ * of every strategy, only one of which does any work. Strategies the key
+ * type does not support are stood in for by nested loop iterators.
+ */
+template <typename InputIterator1, typename InputIterator2,
+          typename KeyA, typename KeyB>
+class auto_join_iterator
+{
+public:
+    using key_type = std::common_type_t<
+            detail::key_t<KeyA, detail::value_t<InputIterator1>>,
+            detail::key_t<KeyB, detail::value_t<InputIterator2>>>;
+    using nested_loop_iterator = join_iterator<InputIterator1, InputIterator2,
+            detail::key_equal<KeyA, KeyB, key_type>>;
+    using is_hashable = detail::is_hashable<key_type>;
+    using is_ordered = detail::is_ordered<key_type>;
+    using hash_iterator = std::conditional_t<is_hashable::value,
+            hash_join_iterator<InputIterator1, InputIterator2, KeyA, KeyB>,
+            nested_loop_iterator>;
+    using merge_iterator = std::conditional_t<is_ordered::value,
+            merge_join_iterator<InputIterator1, InputIterator2, KeyA, KeyB>,
+            nested_loop_iterator>;
+
+    using iterator_category = std::input_iterator_tag;
+    using value_type = typename nested_loop_iterator::value_type;
+    using difference_type =
+            typename std::iterator_traits<InputIterator1>::difference_type;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+public:
+    auto_join_iterator(join_hint strategy, nested_loop_iterator nested_loop,
+                       hash_iterator hash, merge_iterator merge)
+        : _strategy{strategy},
+          _nested_loop{std::move(nested_loop)},
+          _hash{std::move(hash)},
+          _merge{std::move(merge)}
+    {}
+
+    // The strategy executing the join; never join_hint::automatic.
+    join_hint strategy() const noexcept { return _strategy; }
+
+    auto_join_iterator& operator++()
+    {
+        switch (_strategy)
+        {
+        case join_hint::hash: ++_hash; break;
+        case join_hint::merge: ++_merge; break;
+        default: ++_nested_loop; break;
+        }
+        return *this;
+    }
+
+    auto_join_iterator operator++(int)
+    {
+        auto_join_iterator tmp(*this);
+        operator++();
+        return tmp;
+    }
+
+    value_type operator*() const noexcept
+    {
+        switch (_strategy)
+        {
+        case join_hint::hash: return *_hash;
+        case join_hint::merge: return *_merge;
+        default: return *_nested_loop;
+        }
+    }
+
+    bool equal(const auto_join_iterator& rhs) const
+    {
+        switch (_strategy)
+        {
+        case join_hint::hash: return _hash == rhs._hash;
+        case join_hint::merge: return _merge == rhs._merge;
+        default: return _nested_loop == rhs._nested_loop;
+        }
+    }
+
+private:
+    join_hint _strategy;
+    nested_loop_iterator _nested_loop;
+    hash_iterator _hash;
+    merge_iterator _merge;
+};
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator==(const auto_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const auto_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return lhs.equal(rhs);
+}
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator!=(const auto_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const auto_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return !lhs.equal(rhs);
+}
+
+/**
+ * Equi-join with the algorithm chosen at run time from the declared
+ * sortedness, the input sizes where random access makes them known, the
+ * hint and what the key type supports. The chosen operator then runs as it
+ * would when named explicitly; the iterators of the others stay parked at
+ * the end of the inputs.
+ */
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB>
+auto operator%(const EnumerableFrom& range,
+               const join_on_auto_closure<EnumerableJoinOn, KeyA, KeyB>& join_on)
+{
+    auto b1 = std::cbegin(range);
+    auto b2 = std::cbegin(join_on.range());
+    auto e1 = std::cend(range);
+    auto e2 = std::cend(join_on.range());
+
+    using iterator_type = auto_join_iterator<decltype(b1), decltype(b2),
+                                             KeyA, KeyB>;
+    using nested_loop_iterator = typename iterator_type::nested_loop_iterator;
+    using is_hashable = typename iterator_type::is_hashable;
+    using is_ordered = typename iterator_type::is_ordered;
+    using equal_type = detail::key_equal<KeyA, KeyB,
+                                         typename iterator_type::key_type>;
+
+    const auto strategy = detail::choose_join(
+            detail::size_hint(b1, e1), detail::size_hint(b2, e2),
+            join_on.is_sorted(), join_on.strategy(),
+            is_hashable::value, is_ordered::value);
+    const auto& joined = join_on.range();
+    const equal_type equal{join_on.key_a(), join_on.key_b()};
+
+    // Iterators of the strategies not chosen, parked at the ends.
+    const auto parked_nested_loop = enumerable<nested_loop_iterator>{
+            {e1, e1, e2, e2, equal}, {e1, e1, e2, e2, equal}};
+
+    const auto nested_loop = strategy == join_hint::nested_loop
+            ? range % join_on_closure<EnumerableJoinOn, equal_type>{
+                      joined, equal}
+            : parked_nested_loop;
+    const auto hash = detail::auto_hash_join(
+            is_hashable{}, strategy == join_hint::hash, range, joined,
+            equal.key_a, equal.key_b, parked_nested_loop);
+    const auto merge = detail::auto_merge_join(
+            is_ordered{}, strategy == join_hint::merge, range, joined,
+            equal.key_a, equal.key_b, parked_nested_loop);
+
+    return enumerable<iterator_type>{
+        { strategy, nested_loop.begin(), hash.begin(), merge.begin() },
+        { strategy, nested_loop.end(), hash.end(), merge.end() }};
+}
 }
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace cinq
+{
+
+namespace detail
+{
+    //
+    // Key extractors are either callables or pointers to data members, so
+    // both on_keys([](auto& a) { return a.id; }, ...) and
+    // on_keys(&A::id, ...) are accepted.
+    //
+    template <typename Key, typename T>
+    decltype(auto) invoke_key(const Key& key, const T& value, std::true_type)
+    {
+        return value.*key;
+    }
+
+    template <typename Key, typename T>
+    decltype(auto) invoke_key(const Key& key, const T& value, std::false_type)
+    {
+        return key(value);
+    }
+
+    template <typename Key, typename T>
+    decltype(auto) invoke_key(const Key& key, const T& value)
+    {
+        return invoke_key(key, value,
+                          std::is_member_object_pointer<Key>{});
+    }
+
+    template <typename Key, typename T>
+    using key_t = std::decay_t<decltype(
+            invoke_key(std::declval<const Key&>(), std::declval<const T&>()))>;
+
+    template <typename Iterator>
+    using value_t = typename std::iterator_traits<Iterator>::value_type;
+
+    //
+    // std::hash is the identity for integers in common implementations, which
+    // clusters badly in power-of-two tables, so every hash goes through the
+    // 64-bit finalizer of MurmurHash3 before use.
+    //
+    inline std::size_t mix_hash(std::size_t h) noexcept
+    {
+        std::uint64_t x = h;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return static_cast<std::size_t>(x);
+    }
+
+    template <typename Key>
+    std::size_t hash_key(const Key& key)
+    {
+        return mix_hash(std::hash<Key>{}(key));
+    }
+
+    //
+    // Whether keys can go into a hash table, i.e. std::hash is enabled for
+    // them, and whether they can be merged, i.e. ordered by operator<.
+    //
+    template <typename Key, typename = void>
+    struct is_hashable : std::false_type {};
+
+    template <typename Key>
+    struct is_hashable<Key, decltype(void(
+            std::hash<Key>{}(std::declval<const Key&>())))>
+        : std::true_type {};
+
+    template <typename Key, typename = void>
+    struct is_ordered : std::false_type {};
+
+    template <typename Key>
+    struct is_ordered<Key, decltype(void(
+            bool(std::declval<const Key&>() < std::declval<const Key&>())))>
+        : std::true_type {};
+
+    //
+    // Number of elements in [begin, end) when it can be found in constant
+    // time, or npos_size otherwise.
+    //
+    constexpr std::size_t npos_size = static_cast<std::size_t>(-1);
+
+    template <typename Iterator>
+    std::size_t size_hint(Iterator begin, Iterator end,
+                          std::random_access_iterator_tag)
+    {
+        return static_cast<std::size_t>(std::distance(begin, end));
+    }
+
+    template <typename Iterator>
+    std::size_t size_hint(Iterator, Iterator, std::input_iterator_tag)
+    {
+        return npos_size;
+    }
+
+    template <typename Iterator>
+    std::size_t size_hint(Iterator begin, Iterator end)
+    {
+        return size_hint(begin, end,
+                typename std::iterator_traits<Iterator>::iterator_category{});
+    }
+}
+
+}
@@ -0,0 +1,428 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cinq/enumerable.hpp>
+#include <cinq/key.hpp>
+
+namespace cinq {
+
+/**
+ * A binary relation taking part in a leapfrog_join: the elements of range,
+ * each binding variable var_x to key_x(element) and variable var_y to
+ * key_y(element). Variables are numbered from 0.
+ */
+template <typename Enumerable, typename KeyX, typename KeyY>
+struct atom_closure
+{
+    const Enumerable& range;
+    KeyX key_x;
+    KeyY key_y;
+    std::size_t var_x;
+    std::size_t var_y;
+};
+
+template <typename Enumerable, typename KeyX, typename KeyY>
+atom_closure<Enumerable, std::decay_t<KeyX>, std::decay_t<KeyY>>
+atom(const Enumerable& range, KeyX&& key_x, KeyY&& key_y,
+     std::size_t var_x, std::size_t var_y)
+{
+    return {range, std::forward<KeyX>(key_x), std::forward<KeyY>(key_y),
+            var_x, var_y};
+}
+
+namespace detail
+{
+
+template <typename Atom>
+struct atom_key;
+
+template <typename Enumerable, typename KeyX, typename KeyY>
+struct atom_key<atom_closure<Enumerable, KeyX, KeyY>>
+{
+    using value_type = value_t<decltype(std::cbegin(std::declval<const Enumerable&>()))>;
+    using type = std::common_type_t<key_t<KeyX, value_type>,
+                                    key_t<KeyY, value_type>>;
+};
+
+// First position in [first, last) not satisfying pred, for a pred that
+// holds on a prefix. Doubling steps from first keep seeks to nearby keys
+// logarithmic in the distance covered rather than in the range.
+template <typename Iterator, typename Pred>
+Iterator gallop(Iterator first, Iterator last, Pred pred)
+{
+    std::ptrdiff_t step = 1;
+    while (step < last - first && pred(first[step]))
+    {
+        first += step;
+        step *= 2;
+    }
+    return std::partition_point(first, first + std::min(step, last - first),
+                                pred);
+}
+
+//
+// Trie over the distinct (x, y) key pairs of a relation, stored sorted. The
+// cursor descends from the root to the level of x values and then to the
+// y values under the current x.
+//
+template <typename K>
+class trie_cursor
+{
+public:
+    using rows_type = std::vector<std::pair<K, K>>;
+
+public:
+    explicit trie_cursor(const rows_type& rows) noexcept
+        : _rows{&rows}
+    {}
+
+    void open()
+    {
+        if (++_level == 0)
+        {
+            _pos = _rows->begin();
+            _end = _rows->end();
+        }
+        else
+        {
+            _parent = _pos;
+            _end = run_end();
+        }
+    }
+
+    void up() noexcept
+    {
+        if (_level-- == 1)
+        {
+            _pos = _parent;
+            _end = _rows->end();
+        }
+    }
+
+    bool at_end() const noexcept { return _pos == _end; }
+
+    const K& key() const noexcept
+    {
+        return _level == 0 ? _pos->first : _pos->second;
+    }
+
+    void next()
+    {
+        if (_level == 0)
+            _pos = run_end();
+        else
+            ++_pos;
+    }
+
+    // Moves to the first key not below k.
+    void seek(const K& k)
+    {
+        if (_level == 0)
+            _pos = gallop(_pos, _end, [&k](const auto& r) { return r.first < k; });
+        else
+            _pos = gallop(_pos, _end, [&k](const auto& r) { return r.second < k; });
+    }
+
+private:
+    using iterator = typename rows_type::const_iterator;
+
+    // End of the rows sharing the current x.
+    iterator run_end() const
+    {
+        const K& x = _pos->first;
+        return gallop(_pos, _rows->end(),
+                      [&x](const auto& r) { return !(x < r.first); });
+    }
+
+private:
+    const rows_type* _rows;
+    int _level = -1;
+    iterator _pos;
+    iterator _end;
+    iterator _parent;
+};
+
+//
+// Search state of a leapfrog triejoin, shared by the iterators over it.
+// Variables are bound in order; at each depth the cursors of the atoms
+// mentioning that variable leapfrog to their next common key.
+//
+template <typename K, std::size_t N>
+class leapfrog_state
+{
+public:
+    using rows_type = typename trie_cursor<K>::rows_type;
+
+public:
+    leapfrog_state() = default;
+    leapfrog_state(const leapfrog_state&) = delete;
+    leapfrog_state& operator=(const leapfrog_state&) = delete;
+
+    // Adds a relation over the given variables, with x and y as keyed
+    // in rows.
+    void add(rows_type rows, std::size_t var_x, std::size_t var_y)
+    {
+        if (var_x >= N || var_y >= N || var_x == var_y)
+            throw std::invalid_argument{"cinq: invalid leapfrog_join variables"};
+        if (var_y < var_x)
+        {
+            // Store the earlier variable first, as the trie binds it first.
+            for (auto& row : rows)
+                std::swap(row.first, row.second);
+            std::swap(var_x, var_y);
+        }
+        if (!std::is_sorted(rows.begin(), rows.end()))
+            std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+        _rows.push_back(std::make_unique<rows_type>(std::move(rows)));
+        _vars.emplace_back(var_x, var_y);
+    }
+
+    void start()
+    {
+        _cursors.reserve(_rows.size());
+        for (std::size_t i = 0; i < _rows.size(); ++i)
+        {
+            _cursors.emplace_back(*_rows[i]);
+            _levels[_vars[i].first].push_back(&_cursors.back());
+            _levels[_vars[i].second].push_back(&_cursors.back());
+        }
+        for (const auto& level : _levels)
+        {
+            if (level.empty())
+                throw std::invalid_argument{
+                        "cinq: leapfrog_join variable without an atom"};
+        }
+        _depth = 0;
+        open();
+        search();
+    }
+
+    void advance()
+    {
+        next();
+        search();
+    }
+
+    bool done() const noexcept { return _done; }
+    const std::array<K, N>& binding() const noexcept { return _binding; }
+
+private:
+    using level_type = std::vector<trie_cursor<K>*>;
+
+    // Descends to the next complete binding from the current depth, going
+    // back up whenever a level runs out of common keys.
+    void search()
+    {
+        for (;;)
+        {
+            if (_at_end[_depth])
+            {
+                for (auto* cursor : _levels[_depth])
+                    cursor->up();
+                if (_depth == 0)
+                {
+                    _done = true;
+                    return;
+                }
+                --_depth;
+                next();
+                continue;
+            }
+            _binding[_depth] = _levels[_depth][_p[_depth]]->key();
+            if (_depth == N - 1)
+                return;
+            ++_depth;
+            open();
+        }
+    }
+
+    void open()
+    {
+        auto& level = _levels[_depth];
+        _at_end[_depth] = false;
+        for (auto* cursor : level)
+        {
+            cursor->open();
+            _at_end[_depth] = _at_end[_depth] || cursor->at_end();
+        }
+        if (_at_end[_depth])
+            return;
+        std::sort(level.begin(), level.end(),
+                  [](const auto* a, const auto* b) { return a->key() < b->key(); });
+        _p[_depth] = 0;
+        leapfrog();
+    }
+
+    void next()
+    {
+        auto& level = _levels[_depth];
+        auto& p = _p[_depth];
+        level[p]->next();
+        if (level[p]->at_end())
+        {
+            _at_end[_depth] = true;
+            return;
+        }
+        p = (p + 1) % level.size();
+        leapfrog();
+    }
+
+    // Seeks the cursors round-robin to the largest key among them until all
+    // agree, leaving _p on one holding the common key.
+    void leapfrog()
+    {
+        auto& level = _levels[_depth];
+        auto& p = _p[_depth];
+        K max = level[(p + level.size() - 1) % level.size()]->key();
+        for (;;)
+        {
+            if (!(level[p]->key() < max))
+                return;
+            level[p]->seek(max);
+            if (level[p]->at_end())
+            {
+                _at_end[_depth] = true;
+                return;
+            }
+            max = level[p]->key();
+            p = (p + 1) % level.size();
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<rows_type>> _rows;
+    std::vector<std::pair<std::size_t, std::size_t>> _vars;
+    std::vector<trie_cursor<K>> _cursors;
+    std::array<level_type, N> _levels;
+    std::array<std::size_t, N> _p{};
+    std::array<bool, N> _at_end{};
+    std::array<K, N> _binding{};
+    std::size_t _depth = 0;
+    bool _done = false;
+};
+
+template <typename K, std::size_t N, typename Enumerable,
+          typename KeyX, typename KeyY>
+void add_atom(leapfrog_state<K, N>& state,
+              const atom_closure<Enumerable, KeyX, KeyY>& atom)
+{
+    typename leapfrog_state<K, N>::rows_type rows;
+    auto begin = std::cbegin(atom.range);
+    auto end = std::cend(atom.range);
+    auto size = size_hint(begin, end);
+    if (size != npos_size)
+        rows.reserve(size);
+    for (; begin != end; ++begin)
+        rows.emplace_back(invoke_key(atom.key_x, *begin),
+                          invoke_key(atom.key_y, *begin));
+    state.add(std::move(rows), atom.var_x, atom.var_y);
+}
+
+}
+
+/**
+ * leapfrog_join_iterator is a single-pass input iterator over the variable
+ * bindings found by a leapfrog_join. All copies of an iterator share one
+ * position.
+ */
+template <typename K, std::size_t N>
+class leapfrog_join_iterator
+{
+public:
+    using state_type = detail::leapfrog_state<K, N>;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::array<K, N>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+public:
+    explicit leapfrog_join_iterator(std::shared_ptr<state_type> state = nullptr)
+        : _state{std::move(state)}
+    {}
+
+    leapfrog_join_iterator& operator++()
+    {
+        _state->advance();
+        return *this;
+    }
+
+    leapfrog_join_iterator operator++(int)
+    {
+        leapfrog_join_iterator tmp(*this);
+        operator++();
+        return tmp;
+    }
+
+    reference operator*() const noexcept { return _state->binding(); }
+    pointer operator->() const noexcept { return &_state->binding(); }
+
+    bool equal(const leapfrog_join_iterator& rhs) const
+    {
+        return at_end() ? rhs.at_end() : _state == rhs._state;
+    }
+
+private:
+    bool at_end() const noexcept { return !_state || _state->done(); }
+
+private:
+    std::shared_ptr<state_type> _state;
+};
+
+template <typename K, std::size_t N>
+bool operator==(const leapfrog_join_iterator<K, N>& lhs,
+                const leapfrog_join_iterator<K, N>& rhs)
+{
+    return lhs.equal(rhs);
+}
+
+template <typename K, std::size_t N>
+bool operator!=(const leapfrog_join_iterator<K, N>& lhs,
+                const leapfrog_join_iterator<K, N>& rhs)
+{
+    return !lhs.equal(rhs);
+}
+
+/**
+ * Leapfrog triejoin: the distinct bindings of variables 0 .. N-1 that
+ * satisfy every atom, as std::array values in lexicographic order. Each
+ * atom's key pairs are sorted (unless already sorted) and deduplicated into
+ * a trie; variables are then bound one at a time by intersecting the keys
+ * of all atoms that mention them, with galloping seeks. The work is bounded
+ * by the worst-case output size of the query rather than by pairwise
+ * intermediate results, which makes cyclic queries such as triangles
+ * tractable:
+ *
+ *     leapfrog_join<3>(atom(edges, &edge::from, &edge::to, 0, 1),
+ *                      atom(edges, &edge::from, &edge::to, 1, 2),
+ *                      atom(edges, &edge::from, &edge::to, 0, 2))
+ *
+ * Every variable must occur in some atom. Keys of all atoms are converted
+ * to their common type.
+ */
+template <std::size_t N, typename... Atoms>
+auto leapfrog_join(const Atoms&... atoms)
+{
+    static_assert(N > 0 && sizeof...(Atoms) > 0,
+                  "leapfrog join needs variables and atoms");
+    using key_type = std::common_type_t<typename detail::atom_key<Atoms>::type...>;
+    using iterator_type = leapfrog_join_iterator<key_type, N>;
+
+    auto state = std::make_shared<typename iterator_type::state_type>();
+    int expand[] = { (detail::add_atom(*state, atoms), 0)... };
+    (void)expand;
+    state->start();
+
+    return enumerable<iterator_type>{ iterator_type{state}, iterator_type{} };
+}
+
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <cinq/enumerable.hpp>
+#include <cinq/hash_join.hpp>
+#include <cinq/key.hpp>
+
+namespace cinq {
+
+/**
+ * left_join_iterator is a single-pass input iterator over the rows of a left
+ * outer equi-join. The left input is walked once and probed against a hash
+ * table over the right input; every left element yields one row per match,
+ * or a single row with a null right element when it has none.
+ */
+template <typename InputIterator1, typename InputIterator2,
+          typename KeyA, typename KeyB>
+class left_join_iterator
+{
+public:
+    using state_type = detail::hash_join_state<InputIterator1, InputIterator2,
+                                               KeyA, KeyB>;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::pair<const typename state_type::value_type1&,
+                                 const typename state_type::value_type2*>;
+    using difference_type =
+            typename std::iterator_traits<InputIterator1>::difference_type;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+public:
+    left_join_iterator(InputIterator1 begin, InputIterator1 end,
+                       std::shared_ptr<const state_type> state)
+        : _it{std::move(begin)},
+          _end{std::move(end)},
+          _state{std::move(state)}
+    {
+        seek();
+    }
+
+    left_join_iterator& operator++()
+    {
+        if (_slot != npos)
+        {
+            const key_type key = detail::invoke_key(_state->key_a, *_it);
+            _slot = match(key, _state->table2->next(_hash, _slot));
+            if (_slot != npos)
+                return *this;
+        }
+        ++_it;
+        seek();
+        return *this;
+    }
+
+    left_join_iterator operator++(int)
+    {
+        left_join_iterator tmp(*this);
+        operator++();
+        return tmp;
+    }
+
+    value_type operator*() const noexcept
+    {
+        return value_type{ *_it, _slot != npos ? _state->table2->payload(_slot)
+                                               : nullptr };
+    }
+
+    bool equal(const left_join_iterator& rhs) const
+    {
+        return _it == rhs._it && _slot == rhs._slot;
+    }
+
+private:
+    using key_type = typename state_type::key_type;
+
+    // Positions on the first match of the current left element, or on its
+    // unmatched row.
+    void seek()
+    {
+        _slot = npos;
+        if (_it == _end)
+            return;
+        const key_type key = detail::invoke_key(_state->key_a, *_it);
+        _hash = detail::hash_key(key);
+        _slot = match(key, _state->table2->find(_hash));
+    }
+
+    std::size_t match(const key_type& key, std::size_t pos) const
+    {
+        const auto& table = *_state->table2;
+        for (; pos != npos; pos = table.next(_hash, pos))
+        {
+            if (detail::invoke_key(_state->key_b, *table.payload(pos)) == key)
+                return pos;
+        }
+        return npos;
+    }
+
+private:
+    InputIterator1 _it;
+    InputIterator1 _end;
+    std::size_t _hash = 0;
+    std::size_t _slot = npos;
+    std::shared_ptr<const state_type> _state;
+};
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+constexpr std::size_t left_join_iterator<It1, It2, KeyA, KeyB>::npos;
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator==(const left_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const left_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return lhs.equal(rhs);
+}
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator!=(const left_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const left_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return !lhs.equal(rhs);
+}
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+struct left_join_on_keys_closure
+{
+    const Enumerable& range;
+    KeyA key_a;
+    KeyB key_b;
+};
+
+template <typename Enumerable>
+class left_join_closure
+{
+public:
+    left_join_closure(const Enumerable& range) noexcept
+        : _range{range}
+    {}
+
+    /**
+     * Left outer equi-join on the keys extracted by key_a from the left input
+     * and by key_b from this range. Rows are std::pair<const A&, const B*>,
+     * the pointer being null for left elements without a match.
+     */
+    template <typename KeyA, typename KeyB>
+    left_join_on_keys_closure<Enumerable, std::decay_t<KeyA>,
+                              std::decay_t<KeyB>>
+    on_keys(KeyA&& key_a, KeyB&& key_b) const
+    {
+        return {_range, std::forward<KeyA>(key_a), std::forward<KeyB>(key_b)};
+    }
+
+private:
+    const Enumerable& _range;
+};
+
+template <typename Enumerable>
+left_join_closure<Enumerable> left_join(const Enumerable& range) noexcept
+{
+    return {range};
+}
+
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB>
+auto operator%(const EnumerableFrom& range,
+               const left_join_on_keys_closure<EnumerableJoinOn, KeyA, KeyB>& join_on)
+{
+    auto b1 = std::cbegin(range);
+    auto b2 = std::cbegin(join_on.range);
+    auto e1 = std::cend(range);
+    auto e2 = std::cend(join_on.range);
+
+    using iterator_type = left_join_iterator<decltype(b1), decltype(b2),
+                                             KeyA, KeyB>;
+    using state_type = typename iterator_type::state_type;
+
+    auto state = std::make_shared<state_type>(join_on.key_a, join_on.key_b,
+                                              false);
+    state->table2 = detail::build_table<typename state_type::key_type>(
+            b2, e2, state->key_b);
+
+    return enumerable<iterator_type>{
+        { b1, e1, state },
+        { e1, e1, state }};
+}
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <cinq/enumerable.hpp>
+
+namespace cinq {
+
+namespace detail
+{
+
+//
+// Join output computed ahead of iteration, as addresses of the joined
+// elements. Rows are kept in chunks so that producers running in parallel
+// can each fill their own chunk; iteration visits chunks in order.
+//
+template <typename T1, typename T2>
+using joined_rows = std::vector<std::vector<std::pair<const T1*, const T2*>>>;
+
+}
+
+/**
+ * materialized_join_iterator is an input iterator over join rows computed
+ * ahead of time by one of the materializing join operators. It yields the
+ * same std::pair<const T1&, const T2&> rows as the pipelined joins.
+ */
+template <typename T1, typename T2>
+class materialized_join_iterator
+{
+public:
+    using rows_type = detail::joined_rows<T1, T2>;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::pair<const T1&, const T2&>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+public:
+    materialized_join_iterator(std::shared_ptr<const rows_type> rows,
+                               std::size_t chunk)
+        : _rows{std::move(rows)},
+          _chunk{chunk}
+    {
+        skip_empty();
+    }
+
+    materialized_join_iterator& operator++()
+    {
+        if (++_row == (*_rows)[_chunk].size())
+        {
+            _row = 0;
+            ++_chunk;
+            skip_empty();
+        }
+        return *this;
+    }
+
+    materialized_join_iterator operator++(int)
+    {
+        materialized_join_iterator tmp(*this);
+        operator++();
+        return tmp;
+    }
+
+    value_type operator*() const noexcept
+    {
+        const auto& row = (*_rows)[_chunk][_row];
+        return value_type{ *row.first, *row.second };
+    }
+
+    bool equal(const materialized_join_iterator& rhs) const
+    {
+        return _chunk == rhs._chunk && _row == rhs._row;
+    }
+
+private:
+    void skip_empty()
+    {
+        while (_chunk < _rows->size() && (*_rows)[_chunk].empty())
+            ++_chunk;
+    }
+
+private:
+    std::shared_ptr<const rows_type> _rows;
+    std::size_t _chunk;
+    std::size_t _row = 0;
+};
+
+template <typename T1, typename T2>
+bool operator==(const materialized_join_iterator<T1, T2>& lhs,
+                const materialized_join_iterator<T1, T2>& rhs)
+{
+    return lhs.equal(rhs);
+}
+
+template <typename T1, typename T2>
+bool operator!=(const materialized_join_iterator<T1, T2>& lhs,
+                const materialized_join_iterator<T1, T2>& rhs)
+{
+    return !lhs.equal(rhs);
+}
+
+namespace detail
+{
+    template <typename T1, typename T2>
+    auto materialized(std::shared_ptr<const joined_rows<T1, T2>> rows)
+    {
+        using iterator_type = materialized_join_iterator<T1, T2>;
+        auto chunks = rows->size();
+        return enumerable<iterator_type>{{rows, 0}, {rows, chunks}};
+    }
+}
+
+}
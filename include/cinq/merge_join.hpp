@@ -0,0 +1,172 @@
+#pragma once
+
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <cinq/enumerable.hpp>
+#include <cinq/key.hpp>
+
+namespace cinq {
+
+/**
+ * merge_join_iterator is a single-pass input iterator over the rows of an
+ * equi-join of two inputs that are both sorted ascending by their keys. Both
+ * inputs are walked once in lockstep; a run of equal keys on the right is
+ * rewound for every left element carrying the same key, so duplicates on
+ * both sides produce their full cross product. No memory is allocated.
+ *
+ * The left input may be single-pass, the right one must be a forward range.
+ */
+template <typename InputIterator1, typename ForwardIterator2,
+          typename KeyA, typename KeyB>
+class merge_join_iterator
+{
+public:
+    using value_type1 = detail::value_t<InputIterator1>;
+    using value_type2 = detail::value_t<ForwardIterator2>;
+    using key_type = std::common_type_t<detail::key_t<KeyA, value_type1>,
+                                        detail::key_t<KeyB, value_type2>>;
+
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::pair<const value_type1&, const value_type2&>;
+    using difference_type =
+            typename std::iterator_traits<InputIterator1>::difference_type;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+public:
+    merge_join_iterator(InputIterator1 begin1, InputIterator1 end1,
+                        ForwardIterator2 begin2, ForwardIterator2 end2,
+                        KeyA key_a, KeyB key_b)
+        : _it1{std::move(begin1)},
+          _end1{std::move(end1)},
+          _it2{begin2},
+          _run{std::move(begin2)},
+          _end2{std::move(end2)},
+          _key_a{std::move(key_a)},
+          _key_b{std::move(key_b)}
+    {
+        seek();
+    }
+
+    merge_join_iterator& operator++()
+    {
+        if (++_it2 != _end2 && key2(_it2) == key1())
+            return *this;
+        ++_it1;
+        seek();
+        return *this;
+    }
+
+    merge_join_iterator operator++(int)
+    {
+        merge_join_iterator tmp(*this);
+        operator++();
+        return tmp;
+    }
+
+    value_type operator*() const noexcept
+    {
+        return value_type{ *_it1, *_it2 };
+    }
+
+    bool equal(const merge_join_iterator& rhs) const
+    {
+        return _it1 == rhs._it1 && _it2 == rhs._it2;
+    }
+
+private:
+    key_type key1() const { return detail::invoke_key(_key_a, *_it1); }
+
+    key_type key2(const ForwardIterator2& it) const
+    {
+        return detail::invoke_key(_key_b, *it);
+    }
+
+    // Positions _it2 at the start of the right run matching _it1, skipping
+    // left elements without a match. _run always points at the first
+    // right element whose key is not below the last left key seen, so a
+    // left duplicate restarts exactly at the run it has to repeat.
+    void seek()
+    {
+        for (; _it1 != _end1; ++_it1)
+        {
+            const key_type key = key1();
+            while (_run != _end2 && key2(_run) < key)
+                ++_run;
+            if (_run == _end2)
+                break;
+            if (!(key < key2(_run)))
+            {
+                _it2 = _run;
+                return;
+            }
+        }
+        // No more matches: collapse into the end iterator state.
+        while (_it1 != _end1)
+            ++_it1;
+        _it2 = _end2;
+    }
+
+private:
+    InputIterator1 _it1;
+    InputIterator1 _end1;
+    ForwardIterator2 _it2;
+    ForwardIterator2 _run;
+    ForwardIterator2 _end2;
+    KeyA _key_a;
+    KeyB _key_b;
+};
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator==(const merge_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const merge_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return lhs.equal(rhs);
+}
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator!=(const merge_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const merge_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return !lhs.equal(rhs);
+}
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class join_on_sorted_closure
+{
+public:
+    join_on_sorted_closure(const Enumerable& range, KeyA key_a, KeyB key_b)
+        : _range{range},
+          _key_a{std::move(key_a)},
+          _key_b{std::move(key_b)}
+    {}
+
+    const Enumerable& range() const noexcept { return _range; }
+    KeyA key_a() const noexcept { return _key_a; }
+    KeyB key_b() const noexcept { return _key_b; }
+
+private:
+    const Enumerable& _range;
+    KeyA _key_a;
+    KeyB _key_b;
+};
+
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB>
+auto operator%(const EnumerableFrom& range,
+               const join_on_sorted_closure<EnumerableJoinOn, KeyA, KeyB>& join_on)
+{
+    auto b1 = std::cbegin(range);
+    auto b2 = std::cbegin(join_on.range());
+    auto e1 = std::cend(range);
+    auto e2 = std::cend(join_on.range());
+
+    using iterator_type = merge_join_iterator<decltype(b1), decltype(b2),
+                                              KeyA, KeyB>;
+    return enumerable<iterator_type>{
+        { b1, e1, b2, e2, join_on.key_a(), join_on.key_b() },
+        { e1, e1, e2, e2, join_on.key_a(), join_on.key_b() }};
+}
+
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cinq/aggregate.hpp>
+#include <cinq/box.hpp>
+#include <cinq/key.hpp>
+#include <cinq/simd.hpp>
+
+namespace cinq {
+
+namespace detail
+{
+
+//
+// The k elements with the smallest keys seen so far, or the largest with
+// Descending, equal keys ordered by position. Candidates are collected up
+// to 2k, then cut back to the best k with nth_element, which also sets the
+// key of the k-th best as the threshold every later element must beat.
+// Once the threshold settles, most elements are rejected by comparing
+// their key to it, and memory stays O(k). Elements are boxed, as those of
+// joins hold references and cannot be assigned. Room for candidates is
+// reserved up to the size of the range when known, or grows with them,
+// so that counts far beyond it cost nothing.
+//
+template <typename Key, typename Value, bool Descending>
+class top_buffer
+{
+public:
+    top_buffer(std::size_t k, std::size_t size_hint)
+        : _k{k},
+          _limit{k > std::numeric_limits<std::size_t>::max() / 2
+                         ? std::numeric_limits<std::size_t>::max() : 2 * k}
+    {
+        if (size_hint != npos_size)
+            _entries.reserve(std::min(_limit, size_hint));
+    }
+
+    static bool better(const Key& a, const Key& b)
+    {
+        return Descending ? b < a : a < b;
+    }
+
+    // Whether the threshold is set, and then, the key to beat.
+    bool full() const noexcept { return _full; }
+    const Key& threshold() const noexcept { return _threshold; }
+
+    bool admits(const Key& key) const
+    {
+        return !_full || better(key, _threshold);
+    }
+
+    void push(const Key& key, const Value& value)
+    {
+        _entries.push_back(entry{key, _position++, value});
+        if (_entries.size() == _limit)
+            prune();
+    }
+
+    // The best k elements, best first.
+    std::vector<Value> drain()
+    {
+        std::sort(_entries.begin(), _entries.end(), before);
+        std::vector<Value> result;
+        result.reserve(std::min(_k, _entries.size()));
+        for (std::size_t i = 0; i < _entries.size() && i < _k; ++i)
+            result.push_back(_entries[i].value.get());
+        return result;
+    }
+
+private:
+    struct entry
+    {
+        Key key;
+        std::size_t position;
+        box<Value> value;
+    };
+
+    static bool before(const entry& a, const entry& b)
+    {
+        return better(a.key, b.key) ||
+               (!better(b.key, a.key) && a.position < b.position);
+    }
+
+    void prune()
+    {
+        auto kth = _entries.begin() + static_cast<std::ptrdiff_t>(_k - 1);
+        std::nth_element(_entries.begin(), kth, _entries.end(), before);
+        _threshold = kth->key;
+        _full = true;
+        _entries.erase(kth + 1, _entries.end());
+    }
+
+private:
+    std::size_t _k;
+    std::size_t _limit;
+    std::vector<entry> _entries;
+    std::size_t _position = 0;
+    Key _threshold{};
+    bool _full = false;
+};
+
+// Offset of the first block of n arithmetic values that holds one better
+// than the threshold, or of the last partial block. Blocks are tested a
+// vector at a time, so rejected values cost no branch each.
+template <bool Descending, std::size_t Block, typename T>
+CINQ_SIMD_INLINE std::size_t skip_worse_lanes(const T* p, std::size_t n, T threshold) noexcept
+{
+    std::size_t i = 0;
+    for (; i + Block <= n; i += Block)
+    {
+        int any = 0;
+        for (std::size_t lane = 0; lane < Block; ++lane)
+            any |= Descending ? threshold < p[i + lane] : p[i + lane] < threshold;
+        if (any)
+            break;
+    }
+    return i;
+}
+
+template <typename T>
+constexpr std::size_t skip_block = 256 / sizeof(T);
+
+template <bool Descending, typename T>
+std::size_t skip_worse_sse2(const T* p, std::size_t n, T threshold) noexcept
+{
+    return skip_worse_lanes<Descending, skip_block<T>>(p, n, threshold);
+}
+
+#if defined(CINQ_SIMD_X86)
+template <bool Descending, typename T>
+CINQ_SIMD_TARGET("avx2")
+std::size_t skip_worse_avx2(const T* p, std::size_t n, T threshold) noexcept
+{
+    return skip_worse_lanes<Descending, skip_block<T>>(p, n, threshold);
+}
+
+template <bool Descending, typename T>
+CINQ_SIMD_TARGET("avx512f,avx512bw")
+std::size_t skip_worse_avx512(const T* p, std::size_t n, T threshold) noexcept
+{
+    return skip_worse_lanes<Descending, skip_block<T>>(p, n, threshold);
+}
+#endif
+
+template <bool Descending, typename T>
+std::size_t skip_worse(const T* p, std::size_t n, T threshold,
+                       simd_isa isa = simd_level()) noexcept
+{
+    switch (isa)
+    {
+#if defined(CINQ_SIMD_X86)
+    case simd_isa::avx512: return skip_worse_avx512<Descending>(p, n, threshold);
+    case simd_isa::avx2: return skip_worse_avx2<Descending>(p, n, threshold);
+#endif
+    default: return skip_worse_sse2<Descending>(p, n, threshold);
+    }
+}
+
+template <bool Descending, typename Iterator, typename Key>
+auto top(Iterator first, Iterator last, const Key& key, std::size_t k, std::false_type)
+{
+    using value_type = value_t<Iterator>;
+    top_buffer<key_t<Key, value_type>, value_type, Descending> buffer{
+            k, size_hint(first, last)};
+    for (; first != last && k != 0; ++first)
+    {
+        const auto& value = *first;
+        decltype(auto) element_key = invoke_key(key, value);
+        if (buffer.admits(element_key))
+            buffer.push(element_key, value);
+    }
+    return buffer.drain();
+}
+
+// Contiguous arithmetic elements ordered by themselves: once the threshold
+// is set, blocks without a candidate are skipped by a vector loop.
+template <bool Descending, typename Iterator, typename Key>
+auto top(Iterator first, Iterator last, const Key&, std::size_t k, std::true_type)
+{
+    using value_type = value_t<Iterator>;
+    const auto n = static_cast<std::size_t>(last - first);
+    top_buffer<value_type, value_type, Descending> buffer{k, n};
+    if (n == 0 || k == 0)
+        return buffer.drain();
+
+    const auto* p = contiguous_data(first);
+    std::size_t i = 0;
+    while (i < n)
+    {
+        if (buffer.full())
+            i += skip_worse<Descending>(p + i, n - i, buffer.threshold());
+        const auto stop = std::min(n, i + skip_block<value_type>);
+        for (; i < stop; ++i)
+        {
+            if (buffer.admits(p[i]))
+                buffer.push(p[i], p[i]);
+        }
+    }
+    return buffer.drain();
+}
+
+template <typename Iterator, typename Key>
+using is_top_vectorizable = std::integral_constant<bool,
+        std::is_same<Key, identity_key>::value && is_contiguous<Iterator>::value &&
+        has_simd_sum<value_t<Iterator>>::value>;
+
+}
+
+template <typename Key, bool Descending>
+struct order_by_closure
+{
+    Key key;
+};
+
+/**
+ * Orders a range by key(element), or by the elements themselves, smallest
+ * first or, descending, largest first, for take() to yield the first of
+ * them.
+ */
+inline
+order_by_closure<detail::identity_key, false> order_by() noexcept
+{
+    return {};
+}
+
+template <typename Key>
+order_by_closure<std::decay_t<Key>, false> order_by(Key&& key)
+{
+    return {std::forward<Key>(key)};
+}
+
+inline
+order_by_closure<detail::identity_key, true> order_by_descending() noexcept
+{
+    return {};
+}
+
+template <typename Key>
+order_by_closure<std::decay_t<Key>, true> order_by_descending(Key&& key)
+{
+    return {std::forward<Key>(key)};
+}
+
+template <typename Iterator, typename Key, bool Descending>
+struct ordering
+{
+    Iterator begin;
+    Iterator end;
+    Key key;
+};
+
+template <typename Enumerable, typename Key, bool Descending>
+auto operator%(const Enumerable& range, const order_by_closure<Key, Descending>& order)
+{
+    return ordering<decltype(std::cbegin(range)), Key, Descending>{
+            std::cbegin(range), std::cend(range), order.key};
+}
+
+struct take_closure
+{
+    std::size_t count;
+};
+
+inline
+take_closure take(std::size_t count) noexcept
+{
+    return {count};
+}
+
+/**
+ * The first count elements of an ordered range, as a std::vector, in one
+ * pass keeping O(count) candidates rather than sorting the whole range.
+ * Elements of equal keys keep their order in the range.
+ */
+template <typename Iterator, typename Key, bool Descending>
+auto operator%(const ordering<Iterator, Key, Descending>& order, const take_closure& take)
+{
+    return detail::top<Descending>(order.begin, order.end, order.key, take.count,
+                                   detail::is_top_vectorizable<Iterator, Key>{});
+}
+
+template <typename Key>
+struct top_k_closure
+{
+    std::size_t count;
+    Key key;
+};
+
+/**
+ * The count elements of a range with the largest key(element), or largest
+ * themselves, largest first: order_by_descending(key) % take(count).
+ */
+inline
+top_k_closure<detail::identity_key> top_k(std::size_t count) noexcept
+{
+    return {count, {}};
+}
+
+template <typename Key>
+top_k_closure<std::decay_t<Key>> top_k(std::size_t count, Key&& key)
+{
+    return {count, std::forward<Key>(key)};
+}
+
+template <typename Enumerable, typename Key>
+auto operator%(const Enumerable& range, const top_k_closure<Key>& top)
+{
+    return range % order_by_descending(top.key) % take(top.count);
+}
+
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cinq
+{
+
+/**
+ * A fixed set of worker threads executing one batch of tasks at a time.
+ *
+ * run(tasks, fn) calls fn(task, worker) for every task in [0, tasks), with
+ * tasks handed out dynamically one at a time, so that tasks of uneven cost
+ * ("morsels") balance across workers. The calling thread takes part as
+ * worker 0, the pool threads are workers 1 to size() - 1. Concurrent calls to
+ * run() are serialized. A call to run() from inside a task of the same pool,
+ * such as a parallel sum in a predicate of a parallel join, runs its tasks
+ * inline on the calling thread, one after another, as worker 0.
+ */
+class thread_pool
+{
+public:
+    explicit thread_pool(unsigned threads = default_size())
+    {
+        threads = std::max(threads, 1u);
+        for (unsigned worker = 1; worker < threads; ++worker)
+            _threads.emplace_back([this, worker] { loop(worker); });
+    }
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (auto& thread : _threads)
+            thread.join();
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    unsigned size() const noexcept
+    {
+        return static_cast<unsigned>(_threads.size()) + 1;
+    }
+
+    template <typename Function>
+    void run(std::size_t tasks, Function&& fn)
+    {
+        // The workers are all busy with the batch this task belongs to.
+        if (current() == this)
+        {
+            for (std::size_t task = 0; task < tasks; ++task)
+                fn(task, 0);
+            return;
+        }
+
+        std::lock_guard<std::mutex> run_lock{_run_mutex};
+        const std::function<void(std::size_t, unsigned)> job =
+                std::forward<Function>(fn);
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _job = &job;
+            _tasks = tasks;
+            _next = 0;
+            _active = static_cast<unsigned>(_threads.size());
+            _error = nullptr;
+            ++_generation;
+        }
+        _wake.notify_all();
+        work(0);
+
+        std::unique_lock<std::mutex> lock{_mutex};
+        _done.wait(lock, [this] { return _active == 0; });
+        _job = nullptr;
+        if (_error)
+            std::rethrow_exception(_error);
+    }
+
+    // Process-wide pool with one worker per hardware thread.
+    static thread_pool& shared()
+    {
+        static thread_pool pool;
+        return pool;
+    }
+
+    static unsigned default_size() noexcept
+    {
+        return std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+private:
+    void loop(unsigned worker)
+    {
+        std::size_t seen = 0;
+        for (;;)
+        {
+            std::unique_lock<std::mutex> lock{_mutex};
+            _wake.wait(lock, [&] { return _stop || _generation != seen; });
+            if (_stop)
+                return;
+            seen = _generation;
+            lock.unlock();
+
+            work(worker);
+
+            lock.lock();
+            if (--_active == 0)
+                _done.notify_all();
+        }
+    }
+
+    // Pool whose task the calling thread is running, if any.
+    static const thread_pool*& current() noexcept
+    {
+        thread_local const thread_pool* pool = nullptr;
+        return pool;
+    }
+
+    void work(unsigned worker)
+    {
+        const auto outer = current();
+        current() = this;
+        for (std::size_t task; (task = _next.fetch_add(1)) < _tasks;)
+        {
+            try
+            {
+                (*_job)(task, worker);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                if (!_error)
+                    _error = std::current_exception();
+                // Drain the remaining tasks.
+                _next = _tasks;
+            }
+        }
+        current() = outer;
+    }
+
+private:
+    std::vector<std::thread> _threads;
+    std::mutex _run_mutex;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    const std::function<void(std::size_t, unsigned)>* _job = nullptr;
+    std::size_t _tasks = 0;
+    std::atomic<std::size_t> _next{0};
+    unsigned _active = 0;
+    std::size_t _generation = 0;
+    std::exception_ptr _error;
+    bool _stop = false;
+};
+
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cinq/enumerable.hpp>
+#include <cinq/hash_join.hpp>
+#include <cinq/hash_table.hpp>
+#include <cinq/key.hpp>
+#include <cinq/materialized_join.hpp>
+#include <cinq/parallel.hpp>
+#include <cinq/partitioned_join.hpp>
+
+namespace cinq {
+
+namespace detail
+{
+
+// Rows of the probe side handed to a worker at a time, and of the build side
+// hashed and scattered per task.
+constexpr std::size_t join_morsel_size = 16 * 1024;
+
+//
+// Parallel radix partitioning of a random access range: every task hashes a
+// slice and counts its partition sizes, a serial prefix sum gives each
+// (slice, partition) pair its own output region, and every task then
+// scatters its slice without synchronization.
+//
+template <typename Iterator, typename Key, typename KeyType>
+radix_partitions<value_t<Iterator>>
+parallel_partition(Iterator begin, Iterator end, const Key& key, KeyType*,
+                   unsigned bits, thread_pool& pool)
+{
+    const auto size = static_cast<std::size_t>(std::distance(begin, end));
+    const std::size_t fanout = std::size_t{1} << bits;
+
+    const std::size_t slices = (size + join_morsel_size - 1) / join_morsel_size;
+    std::vector<std::size_t> hashes(size);
+    std::vector<std::size_t> counts(slices * fanout, 0);
+
+    pool.run(slices, [&](std::size_t slice, unsigned)
+    {
+        auto first = slice * join_morsel_size;
+        auto last = std::min(first + join_morsel_size, size);
+        auto* count = &counts[slice * fanout];
+        for (auto i = first; i < last; ++i)
+        {
+            hashes[i] = hash_key<KeyType>(invoke_key(key, begin[i]));
+            ++count[radix_of(hashes[i], bits)];
+        }
+    });
+
+    radix_partitions<value_t<Iterator>> result;
+    result.offsets.assign(fanout + 1, 0);
+    std::size_t running = 0;
+    for (std::size_t p = 0; p < fanout; ++p)
+    {
+        result.offsets[p] = running;
+        for (std::size_t slice = 0; slice < slices; ++slice)
+        {
+            auto count = counts[slice * fanout + p];
+            counts[slice * fanout + p] = running;
+            running += count;
+        }
+    }
+    result.offsets[fanout] = running;
+
+    result.entries.resize(size);
+    pool.run(slices, [&](std::size_t slice, unsigned)
+    {
+        auto first = slice * join_morsel_size;
+        auto last = std::min(first + join_morsel_size, size);
+        auto* cursor = &counts[slice * fanout];
+        for (auto i = first; i < last; ++i)
+        {
+            result.entries[cursor[radix_of(hashes[i], bits)]++] =
+                    {hashes[i], std::addressof(begin[i])};
+        }
+    });
+    return result;
+}
+
+template <typename T>
+std::vector<hash_table<std::uint32_t>>
+parallel_build(const radix_partitions<T>& parts, thread_pool& pool)
+{
+    const auto fanout = parts.offsets.size() - 1;
+    std::vector<hash_table<std::uint32_t>> tables(fanout);
+    pool.run(fanout, [&](std::size_t p, unsigned)
+    {
+        auto first = parts.offsets[p];
+        auto last = parts.offsets[p + 1];
+        hash_table<std::uint32_t> table(last - first);
+        for (auto i = first; i < last; ++i)
+            table.insert(parts.entries[i].hash,
+                         static_cast<std::uint32_t>(i - first));
+        tables[p] = std::move(table);
+    });
+    return tables;
+}
+
+//
+// Probes morsels of a random access range against partitioned tables, each
+// morsel writing the rows it finds to its own chunk. Rows are emitted by
+// make_row(build_item, probe_item), which puts them in left/right order.
+//
+template <typename Iterator, typename ProbeKey, typename BuildKey,
+          typename KeyType, typename T, typename Rows, typename MakeRow>
+void parallel_probe(Iterator begin, Iterator end, const ProbeKey& probe_key,
+                    const BuildKey& build_key, KeyType*,
+                    const radix_partitions<T>& parts,
+                    const std::vector<hash_table<std::uint32_t>>& tables,
+                    unsigned bits, thread_pool& pool, Rows& rows,
+                    MakeRow make_row)
+{
+    const auto size = static_cast<std::size_t>(std::distance(begin, end));
+    const std::size_t morsels = (size + join_morsel_size - 1) / join_morsel_size;
+    rows.resize(morsels);
+
+    pool.run(morsels, [&](std::size_t morsel, unsigned)
+    {
+        auto first = morsel * join_morsel_size;
+        auto last = std::min(first + join_morsel_size, size);
+        auto& out = rows[morsel];
+        for (auto i = first; i < last; ++i)
+        {
+            const auto& probe = begin[i];
+            const KeyType key = invoke_key(probe_key, probe);
+            const auto hash = hash_key(key);
+            const auto p = radix_of(hash, bits);
+            const auto& table = tables[p];
+            for (auto slot = table.find(hash); slot != table.npos;
+                 slot = table.next(hash, slot))
+            {
+                const auto* build =
+                        parts.entries[parts.offsets[p] + table.payload(slot)].item;
+                if (KeyType(invoke_key(build_key, *build)) == key)
+                    out.push_back(make_row(build, std::addressof(probe)));
+            }
+        }
+    });
+}
+
+}
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class parallel_join_closure
+{
+public:
+    parallel_join_closure(join_on_keys_closure<Enumerable, KeyA, KeyB> keys,
+                          thread_pool& pool)
+        : _keys{std::move(keys)},
+          _pool{pool}
+    {}
+
+    const join_on_keys_closure<Enumerable, KeyA, KeyB>& keys() const noexcept
+    {
+        return _keys;
+    }
+
+    thread_pool& pool() const noexcept { return _pool; }
+
+private:
+    join_on_keys_closure<Enumerable, KeyA, KeyB> _keys;
+    thread_pool& _pool;
+};
+
+/**
+ * Multi-threaded hash join over random access inputs. The smaller input is
+ * hashed and radix-partitioned in parallel, then every partition gets its own
+ * table built by a single worker, so the build needs no locks. The other
+ * input is split into morsels that workers pick up dynamically and probe
+ * independently, each morsel into its own output chunk.
+ *
+ * The join runs to completion in operator%, and the result iterates over the
+ * materialized rows in the order of the probe input.
+ */
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB>
+auto operator%(const EnumerableFrom& range,
+               const parallel_join_closure<EnumerableJoinOn, KeyA, KeyB>& join_on)
+{
+    auto b1 = std::cbegin(range);
+    auto b2 = std::cbegin(join_on.keys().range());
+    auto e1 = std::cend(range);
+    auto e2 = std::cend(join_on.keys().range());
+
+    using iterator1 = decltype(b1);
+    using iterator2 = decltype(b2);
+    static_assert(std::is_base_of<std::random_access_iterator_tag,
+                          typename std::iterator_traits<iterator1>::iterator_category>::value &&
+                  std::is_base_of<std::random_access_iterator_tag,
+                          typename std::iterator_traits<iterator2>::iterator_category>::value,
+                  "parallel join requires random access inputs");
+
+    using value_type1 = detail::value_t<iterator1>;
+    using value_type2 = detail::value_t<iterator2>;
+    using key_type = std::common_type_t<detail::key_t<KeyA, value_type1>,
+                                        detail::key_t<KeyB, value_type2>>;
+    auto* key_tag = static_cast<key_type*>(nullptr);
+
+    auto& pool = join_on.pool();
+    const auto key_a = join_on.keys().key_a();
+    const auto key_b = join_on.keys().key_b();
+    const auto size1 = static_cast<std::size_t>(std::distance(b1, e1));
+    const auto size2 = static_cast<std::size_t>(std::distance(b2, e2));
+    const bool build_left = size1 < size2;
+
+    // Enough partitions for the build to spread over all workers, and for
+    // each of them to stay cache sized.
+    unsigned bits = std::max(
+            build_left ? detail::radix_bits_for<value_type1>(size1)
+                       : detail::radix_bits_for<value_type2>(size2),
+            detail::ceil_log2(pool.size()) + 2);
+    bits = std::min(bits, detail::max_radix_bits);
+
+    auto rows = std::make_shared<detail::joined_rows<value_type1, value_type2>>();
+    if (build_left)
+    {
+        auto parts = detail::parallel_partition(b1, e1, key_a, key_tag, bits, pool);
+        auto tables = detail::parallel_build(parts, pool);
+        detail::parallel_probe(b2, e2, key_b, key_a, key_tag, parts, tables,
+                               bits, pool, *rows,
+                               [](const value_type1* a, const value_type2* b)
+                               { return std::make_pair(a, b); });
+    }
+    else
+    {
+        auto parts = detail::parallel_partition(b2, e2, key_b, key_tag, bits, pool);
+        auto tables = detail::parallel_build(parts, pool);
+        detail::parallel_probe(b1, e1, key_a, key_b, key_tag, parts, tables,
+                               bits, pool, *rows,
+                               [](const value_type2* b, const value_type1* a)
+                               { return std::make_pair(a, b); });
+    }
+
+    return detail::materialized<value_type1, value_type2>(std::move(rows));
+}
+
+}
@@ -0,0 +1,414 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cinq/enumerable.hpp>
+#include <cinq/hash_join.hpp>
+#include <cinq/hash_table.hpp>
+#include <cinq/key.hpp>
+
+namespace cinq {
+
+namespace detail
+{
+
+template <typename T>
+struct hashed_entry
+{
+    std::size_t hash;
+    const T* item;
+};
+
+//
+// Input entries scattered into 2^bits contiguous partitions by the top bits
+// of their hashes; partition p occupies [offsets[p], offsets[p + 1]).
+//
+template <typename T>
+struct radix_partitions
+{
+    std::vector<hashed_entry<T>> entries;
+    std::vector<std::size_t> offsets;
+};
+
+// Build partitions are sized to fit, together with their hash table, in a
+// typical 256KiB L2 cache; the fan-out is bounded so that the write-combining
+// buffers below stay cache resident themselves.
+constexpr std::size_t partition_target_bytes = 256 * 1024;
+constexpr unsigned max_radix_bits = 12;
+
+inline unsigned ceil_log2(std::size_t n) noexcept
+{
+    unsigned bits = 0;
+    while ((std::size_t{1} << bits) < n)
+        ++bits;
+    return bits;
+}
+
+// Partition of a hash when partitioning on its top bits.
+inline std::size_t radix_of(std::size_t hash, unsigned bits) noexcept
+{
+    return bits == 0 ? 0
+                     : static_cast<std::size_t>(
+                               static_cast<std::uint64_t>(hash) >> (64 - bits));
+}
+
+template <typename T>
+unsigned radix_bits_for(std::size_t build_size)
+{
+    // Each build entry costs itself plus two table slots at load factor 1/2.
+    const std::size_t per_entry = sizeof(hashed_entry<T>) * 3;
+    unsigned bits = 0;
+    while (bits < max_radix_bits &&
+           (build_size >> bits) * per_entry > partition_target_bytes)
+        ++bits;
+    return bits;
+}
+
+template <typename Iterator, typename Key, typename KeyType>
+auto hash_entries(Iterator begin, Iterator end, const Key& key, KeyType*)
+{
+    std::vector<hashed_entry<value_t<Iterator>>> entries;
+    auto size = size_hint(begin, end);
+    if (size != npos_size)
+        entries.reserve(size);
+    for (; begin != end; ++begin)
+    {
+        entries.push_back({hash_key<KeyType>(invoke_key(key, *begin)),
+                           std::addressof(*begin)});
+    }
+    return entries;
+}
+
+//
+// Two-pass radix partitioning: a histogram of the partition ids, then a
+// scatter through per-partition software write-combining buffers of one
+// cache line each, so that every store to the output is a full line rather
+// than a random single entry.
+//
+template <typename T>
+radix_partitions<T> radix_partition(const std::vector<hashed_entry<T>>& input,
+                                    unsigned bits)
+{
+    using entry = hashed_entry<T>;
+    constexpr std::size_t line = std::max<std::size_t>(64 / sizeof(entry), 1);
+
+    const std::size_t fanout = std::size_t{1} << bits;
+
+    radix_partitions<T> result;
+    result.offsets.assign(fanout + 1, 0);
+    for (const auto& e : input)
+        ++result.offsets[radix_of(e.hash, bits) + 1];
+    for (std::size_t p = 0; p < fanout; ++p)
+        result.offsets[p + 1] += result.offsets[p];
+
+    result.entries.resize(input.size());
+    std::vector<std::size_t> cursor(result.offsets.begin(),
+                                    result.offsets.end() - 1);
+    std::vector<entry> buffers(fanout * line);
+    std::vector<std::size_t> fill(fanout, 0);
+
+    for (const auto& e : input)
+    {
+        auto p = radix_of(e.hash, bits);
+        auto* buffer = &buffers[p * line];
+        buffer[fill[p]++] = e;
+        if (fill[p] == line)
+        {
+            std::copy(buffer, buffer + line,
+                      result.entries.begin() + cursor[p]);
+            cursor[p] += line;
+            fill[p] = 0;
+        }
+    }
+    for (std::size_t p = 0; p < fanout; ++p)
+    {
+        std::copy(&buffers[p * line], &buffers[p * line] + fill[p],
+                  result.entries.begin() + cursor[p]);
+    }
+    return result;
+}
+
+template <typename InputIterator1, typename InputIterator2,
+          typename KeyA, typename KeyB>
+struct partitioned_join_state
+{
+    using value_type1 = value_t<InputIterator1>;
+    using value_type2 = value_t<InputIterator2>;
+    using key_type = std::common_type_t<key_t<KeyA, value_type1>,
+                                        key_t<KeyB, value_type2>>;
+
+    partitioned_join_state(KeyA a, KeyB b)
+        : key_a{std::move(a)},
+          key_b{std::move(b)}
+    {}
+
+    KeyA key_a;
+    KeyB key_b;
+    bool build_left = false;
+    radix_partitions<value_type1> parts1;
+    radix_partitions<value_type2> parts2;
+    // One table per partition of the build side, mapping hashes to entry
+    // positions within that partition.
+    std::vector<hash_table<std::uint32_t>> tables;
+};
+
+}
+
+/**
+ * partitioned_join_iterator is a single-pass input iterator over the rows of
+ * a radix-partitioned hash join. Both inputs have been scattered into
+ * partitions by hash, and the probe entries of one partition are only ever
+ * looked up in the (cache sized) table of the matching build partition, so
+ * rows come out partition by partition.
+ */
+template <typename InputIterator1, typename InputIterator2,
+          typename KeyA, typename KeyB>
+class partitioned_join_iterator
+{
+public:
+    using state_type = detail::partitioned_join_state<
+            InputIterator1, InputIterator2, KeyA, KeyB>;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::pair<const typename state_type::value_type1&,
+                                 const typename state_type::value_type2&>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+public:
+    partitioned_join_iterator(std::size_t pos,
+                              std::shared_ptr<const state_type> state)
+        : _pos{pos},
+          _state{std::move(state)}
+    {
+        seek();
+    }
+
+    partitioned_join_iterator& operator++()
+    {
+        if (!match(table().next(probe_hash(), _slot)))
+        {
+            ++_pos;
+            seek();
+        }
+        return *this;
+    }
+
+    partitioned_join_iterator operator++(int)
+    {
+        partitioned_join_iterator tmp(*this);
+        operator++();
+        return tmp;
+    }
+
+    value_type operator*() const noexcept
+    {
+        auto build = table().payload(_slot);
+        return value_type{ left(build), right(build) };
+    }
+
+    bool equal(const partitioned_join_iterator& rhs) const
+    {
+        return _pos == rhs._pos && _slot == rhs._slot;
+    }
+
+private:
+    using key_type = typename state_type::key_type;
+
+    const std::vector<std::size_t>& probe_offsets() const noexcept
+    {
+        return _state->build_left ? _state->parts2.offsets
+                                  : _state->parts1.offsets;
+    }
+
+    std::size_t probe_size() const noexcept
+    {
+        return probe_offsets().back();
+    }
+
+    std::size_t probe_hash() const noexcept
+    {
+        return _state->build_left ? _state->parts2.entries[_pos].hash
+                                  : _state->parts1.entries[_pos].hash;
+    }
+
+    const detail::hash_table<std::uint32_t>& table() const noexcept
+    {
+        return _state->tables[_part];
+    }
+
+    // Elements of the current row, given the position of the build entry
+    // within the current build partition.
+    const typename state_type::value_type1& left(std::size_t build) const
+    {
+        const auto& parts = _state->parts1;
+        return *parts.entries[_state->build_left ? parts.offsets[_part] + build
+                                                 : _pos].item;
+    }
+
+    const typename state_type::value_type2& right(std::size_t build) const
+    {
+        const auto& parts = _state->parts2;
+        return *parts.entries[_state->build_left ? _pos
+                                                 : parts.offsets[_part] + build].item;
+    }
+
+    bool match(std::size_t slot)
+    {
+        const auto hash = probe_hash();
+        for (; slot != npos; slot = table().next(hash, slot))
+        {
+            auto build = table().payload(slot);
+            if (key_type(detail::invoke_key(_state->key_a, left(build))) ==
+                key_type(detail::invoke_key(_state->key_b, right(build))))
+            {
+                _slot = slot;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Finds the first match at or after _pos, moving across partitions.
+    void seek()
+    {
+        const auto& offsets = probe_offsets();
+        for (; _pos < probe_size(); ++_pos)
+        {
+            while (offsets[_part + 1] <= _pos)
+                ++_part;
+            if (match(table().find(probe_hash())))
+                return;
+        }
+        _pos = probe_size();
+        _slot = npos;
+    }
+
+private:
+    std::size_t _pos;
+    std::size_t _part = 0;
+    std::size_t _slot = npos;
+    std::shared_ptr<const state_type> _state;
+};
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+constexpr std::size_t partitioned_join_iterator<It1, It2, KeyA, KeyB>::npos;
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator==(const partitioned_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const partitioned_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return lhs.equal(rhs);
+}
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator!=(const partitioned_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const partitioned_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return !lhs.equal(rhs);
+}
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class partitioned_join_closure
+{
+public:
+    partitioned_join_closure(join_on_keys_closure<Enumerable, KeyA, KeyB> keys,
+                             unsigned radix_bits)
+        : _keys{std::move(keys)},
+          _radix_bits{radix_bits}
+    {}
+
+    const join_on_keys_closure<Enumerable, KeyA, KeyB>& keys() const noexcept
+    {
+        return _keys;
+    }
+
+    unsigned radix_bits() const noexcept { return _radix_bits; }
+
+private:
+    join_on_keys_closure<Enumerable, KeyA, KeyB> _keys;
+    unsigned _radix_bits;
+};
+
+/**
+ * Radix-partitioned hash join. Both inputs are hashed and partitioned on the
+ * top radix_bits of the hash (chosen from the build size when zero) so that
+ * each build partition and its table fit in cache, then every partition is
+ * joined on its own. Both inputs must yield lvalues.
+ */
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB>
+auto operator%(const EnumerableFrom& range,
+               const partitioned_join_closure<EnumerableJoinOn, KeyA, KeyB>& join_on)
+{
+    auto b1 = std::cbegin(range);
+    auto b2 = std::cbegin(join_on.keys().range());
+    auto e1 = std::cend(range);
+    auto e2 = std::cend(join_on.keys().range());
+
+    using iterator_type = partitioned_join_iterator<decltype(b1), decltype(b2),
+                                                    KeyA, KeyB>;
+    using state_type = typename iterator_type::state_type;
+    using key_type = typename state_type::key_type;
+
+    auto state = std::make_shared<state_type>(join_on.keys().key_a(),
+                                              join_on.keys().key_b());
+    auto entries1 = detail::hash_entries(b1, e1, state->key_a,
+                                         static_cast<key_type*>(nullptr));
+    auto entries2 = detail::hash_entries(b2, e2, state->key_b,
+                                         static_cast<key_type*>(nullptr));
+    state->build_left = entries1.size() < entries2.size();
+
+    auto build_size = std::min(entries1.size(), entries2.size());
+    unsigned bits = join_on.radix_bits();
+    if (bits == 0)
+    {
+        bits = state->build_left
+                ? detail::radix_bits_for<typename state_type::value_type1>(build_size)
+                : detail::radix_bits_for<typename state_type::value_type2>(build_size);
+    }
+    bits = std::min(bits, detail::max_radix_bits);
+
+    state->parts1 = detail::radix_partition(entries1, bits);
+    entries1 = {};
+    state->parts2 = detail::radix_partition(entries2, bits);
+    entries2 = {};
+
+    auto build_tables = [&state](const auto& parts)
+    {
+        auto fanout = parts.offsets.size() - 1;
+        state->tables.reserve(fanout);
+        for (std::size_t p = 0; p < fanout; ++p)
+        {
+            auto first = parts.offsets[p];
+            auto last = parts.offsets[p + 1];
+            state->tables.emplace_back(last - first);
+            for (auto i = first; i < last; ++i)
+            {
+                state->tables.back().insert(
+                        parts.entries[i].hash,
+                        static_cast<std::uint32_t>(i - first));
+            }
+        }
+    };
+    if (state->build_left)
+        build_tables(state->parts1);
+    else
+        build_tables(state->parts2);
+
+    auto end = state->build_left ? state->parts2.entries.size()
+                                 : state->parts1.entries.size();
+    return enumerable<iterator_type>{
+        { 0, state },
+        { end, state }};
+}
+
+}
@@ -0,0 +1,400 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cinq/box.hpp>
+#include <cinq/enumerable.hpp>
+#include <cinq/hash_join.hpp>
+#include <cinq/hash_table.hpp>
+#include <cinq/key.hpp>
+
+namespace cinq {
+
+/**
+ * Positions of the left and right elements of a join row in their inputs.
+ */
+using row_id_pair = std::pair<std::uint32_t, std::uint32_t>;
+
+namespace detail
+{
+
+// Rows produced per probe batch.
+constexpr std::size_t row_id_batch_size = 1024;
+
+//
+// Hash join over random access inputs producing the positions of joined
+// elements, a batch at a time. The table maps build keys to build
+// positions; probing resumes mid-sequence when a batch fills up.
+//
+template <typename RandomIt1, typename RandomIt2, typename KeyA, typename KeyB>
+class row_id_join_state
+{
+public:
+    using key_type = std::common_type_t<key_t<KeyA, value_t<RandomIt1>>,
+                                        key_t<KeyB, value_t<RandomIt2>>>;
+
+    static constexpr std::size_t npos = hash_table<std::uint32_t>::npos;
+
+public:
+    row_id_join_state(RandomIt1 begin1, std::size_t size1,
+                      RandomIt2 begin2, std::size_t size2,
+                      KeyA key_a, KeyB key_b)
+        : _begin1{std::move(begin1)},
+          _begin2{std::move(begin2)},
+          _size1{size1},
+          _size2{size2},
+          _key_a{std::move(key_a)},
+          _key_b{std::move(key_b)},
+          _build_left{size1 < size2},
+          _table{_build_left ? size1 : size2}
+    {
+        if (_build_left)
+            build(_begin1, _size1, _key_a);
+        else
+            build(_begin2, _size2, _key_b);
+        _batch.reserve(row_id_batch_size);
+        fill();
+    }
+
+    bool done() const noexcept { return _batch.empty(); }
+    const row_id_pair& row() const noexcept { return _batch[_cursor]; }
+
+    void advance()
+    {
+        if (++_cursor == _batch.size())
+            fill();
+    }
+
+private:
+    // Replaces the batch with the next one, which is empty at the end.
+    void fill()
+    {
+        _cursor = 0;
+        _batch.clear();
+        if (_build_left)
+            probe(_begin2, _size2, _key_b, _begin1, _key_a);
+        else
+            probe(_begin1, _size1, _key_a, _begin2, _key_b);
+    }
+
+    template <typename Iterator, typename Key>
+    void build(Iterator begin, std::size_t size, const Key& key)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            _table.insert(hash_key<key_type>(invoke_key(key, begin[i])),
+                          static_cast<std::uint32_t>(i));
+        }
+    }
+
+    template <typename ProbeIt, typename ProbeKey,
+              typename BuildIt, typename BuildKey>
+    void probe(const ProbeIt& probe, std::size_t size, const ProbeKey& probe_key,
+               const BuildIt& build, const BuildKey& build_key)
+    {
+        for (; _probe < size; ++_probe, _slot = npos)
+        {
+            const key_type key = invoke_key(probe_key, probe[_probe]);
+            const auto hash = hash_key(key);
+            auto slot = _slot == npos ? _table.find(hash)
+                                      : _table.next(hash, _slot);
+            for (; slot != npos; slot = _table.next(hash, slot))
+            {
+                const auto pos = _table.payload(slot);
+                if (!(invoke_key(build_key, build[pos]) == key))
+                    continue;
+                const auto probe_pos = static_cast<std::uint32_t>(_probe);
+                _batch.push_back(_build_left ? row_id_pair{pos, probe_pos}
+                                             : row_id_pair{probe_pos, pos});
+                if (_batch.size() == row_id_batch_size)
+                {
+                    _slot = slot;
+                    return;
+                }
+            }
+        }
+    }
+
+private:
+    RandomIt1 _begin1;
+    RandomIt2 _begin2;
+    std::size_t _size1;
+    std::size_t _size2;
+    KeyA _key_a;
+    KeyB _key_b;
+    bool _build_left;
+    hash_table<std::uint32_t> _table;
+
+    std::vector<row_id_pair> _batch;
+    std::size_t _cursor = 0;
+    std::size_t _probe = 0;
+    std::size_t _slot = npos;
+};
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+constexpr std::size_t row_id_join_state<It1, It2, KeyA, KeyB>::npos;
+
+}
+
+/**
+ * row_id_join_iterator is a single-pass input iterator over the row_id_pair
+ * rows of a row id join. All copies of an iterator share one position.
+ */
+template <typename RandomIt1, typename RandomIt2, typename KeyA, typename KeyB>
+class row_id_join_iterator
+{
+public:
+    using state_type = detail::row_id_join_state<RandomIt1, RandomIt2,
+                                                 KeyA, KeyB>;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = row_id_pair;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+public:
+    explicit row_id_join_iterator(std::shared_ptr<state_type> state = nullptr)
+        : _state{std::move(state)}
+    {}
+
+    row_id_join_iterator& operator++()
+    {
+        _state->advance();
+        return *this;
+    }
+
+    row_id_join_iterator operator++(int)
+    {
+        row_id_join_iterator tmp(*this);
+        operator++();
+        return tmp;
+    }
+
+    reference operator*() const noexcept { return _state->row(); }
+    pointer operator->() const noexcept { return &_state->row(); }
+
+    bool equal(const row_id_join_iterator& rhs) const
+    {
+        return at_end() ? rhs.at_end() : _state == rhs._state;
+    }
+
+private:
+    bool at_end() const noexcept { return !_state || _state->done(); }
+
+private:
+    std::shared_ptr<state_type> _state;
+};
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator==(const row_id_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const row_id_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return lhs.equal(rhs);
+}
+
+template <typename It1, typename It2, typename KeyA, typename KeyB>
+bool operator!=(const row_id_join_iterator<It1, It2, KeyA, KeyB>& lhs,
+                const row_id_join_iterator<It1, It2, KeyA, KeyB>& rhs)
+{
+    return !lhs.equal(rhs);
+}
+
+template <typename Enumerable, typename KeyA, typename KeyB>
+class row_id_join_closure
+{
+public:
+    explicit row_id_join_closure(join_on_keys_closure<Enumerable, KeyA, KeyB> keys)
+        : _keys{std::move(keys)}
+    {}
+
+    const join_on_keys_closure<Enumerable, KeyA, KeyB>& keys() const noexcept
+    {
+        return _keys;
+    }
+
+private:
+    join_on_keys_closure<Enumerable, KeyA, KeyB> _keys;
+};
+
+/**
+ * Hash join over random access inputs that yields row_id_pair rows: the
+ * positions of the joined elements rather than references to them. Rows
+ * are produced a batch at a time into a reused buffer, and cost eight bytes
+ * each however wide the elements; gather() and project() then fetch only
+ * what is needed. The table is built over the smaller input, and rows come
+ * out in the order of the other one. Inputs are limited to 2^32 elements.
+ */
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB>
+auto operator%(const EnumerableFrom& range,
+               const row_id_join_closure<EnumerableJoinOn, KeyA, KeyB>& join_on)
+{
+    auto b1 = std::cbegin(range);
+    auto b2 = std::cbegin(join_on.keys().range());
+    auto e1 = std::cend(range);
+    auto e2 = std::cend(join_on.keys().range());
+
+    using iterator1 = decltype(b1);
+    using iterator2 = decltype(b2);
+    static_assert(std::is_base_of<std::random_access_iterator_tag,
+                          typename std::iterator_traits<iterator1>::iterator_category>::value &&
+                  std::is_base_of<std::random_access_iterator_tag,
+                          typename std::iterator_traits<iterator2>::iterator_category>::value,
+                  "row id join requires random access inputs");
+
+    const auto size1 = static_cast<std::size_t>(std::distance(b1, e1));
+    const auto size2 = static_cast<std::size_t>(std::distance(b2, e2));
+    constexpr auto max_size = std::numeric_limits<std::uint32_t>::max();
+    if (size1 > max_size || size2 > max_size)
+        throw std::length_error{"cinq: row id join input too large"};
+
+    using iterator_type = row_id_join_iterator<iterator1, iterator2, KeyA, KeyB>;
+    auto state = std::make_shared<typename iterator_type::state_type>(
+            b1, size1, b2, size2,
+            join_on.keys().key_a(), join_on.keys().key_b());
+
+    return enumerable<iterator_type>{ iterator_type{state}, iterator_type{} };
+}
+
+/**
+ * gather_iterator is an input iterator applying a function to every element
+ * of another input iterator, used to turn row ids back into values.
+ */
+template <typename InputIterator, typename Function>
+class gather_iterator
+{
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = decltype(std::declval<const Function&>()(
+            *std::declval<InputIterator>()));
+    using difference_type =
+            typename std::iterator_traits<InputIterator>::difference_type;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+public:
+    gather_iterator(InputIterator it, Function fn)
+        : _it{std::move(it)},
+          _fn{std::move(fn)}
+    {}
+
+    gather_iterator& operator++()
+    {
+        ++_it;
+        return *this;
+    }
+
+    gather_iterator operator++(int)
+    {
+        gather_iterator tmp(*this);
+        operator++();
+        return tmp;
+    }
+
+    value_type operator*() const { return _fn.get()(*_it); }
+
+    bool equal(const gather_iterator& rhs) const { return _it == rhs._it; }
+
+private:
+    InputIterator _it;
+    detail::box<Function> _fn;
+};
+
+template <typename It, typename Function>
+bool operator==(const gather_iterator<It, Function>& lhs,
+                const gather_iterator<It, Function>& rhs)
+{
+    return lhs.equal(rhs);
+}
+
+template <typename It, typename Function>
+bool operator!=(const gather_iterator<It, Function>& lhs,
+                const gather_iterator<It, Function>& rhs)
+{
+    return !lhs.equal(rhs);
+}
+
+namespace detail
+{
+
+template <typename RandomIt1, typename RandomIt2>
+struct gather_rows
+{
+    std::pair<const value_t<RandomIt1>&, const value_t<RandomIt2>&>
+    operator()(const row_id_pair& ids) const
+    {
+        return {a[ids.first], b[ids.second]};
+    }
+
+    RandomIt1 a;
+    RandomIt2 b;
+};
+
+template <typename RandomIt1, typename RandomIt2, typename KeyA, typename KeyB>
+struct project_rows
+{
+    auto operator()(const row_id_pair& ids) const
+    {
+        return std::make_pair(invoke_key(key_a, a[ids.first]),
+                              invoke_key(key_b, b[ids.second]));
+    }
+
+    RandomIt1 a;
+    RandomIt2 b;
+    KeyA key_a;
+    KeyB key_b;
+};
+
+}
+
+template <typename Function>
+struct gather_closure
+{
+    Function fn;
+};
+
+/**
+ * Turns row ids into pairs of references to the elements of a and b at
+ * those positions, as a regular join would have yielded.
+ */
+template <typename RangeA, typename RangeB>
+auto gather(const RangeA& a, const RangeB& b)
+{
+    using function_type = detail::gather_rows<decltype(std::cbegin(a)),
+                                              decltype(std::cbegin(b))>;
+    return gather_closure<function_type>{{std::cbegin(a), std::cbegin(b)}};
+}
+
+/**
+ * Turns row ids into pairs of the keys extracted by key_a and key_b from the
+ * elements of a and b at those positions, reading only those fields.
+ */
+template <typename RangeA, typename KeyA, typename RangeB, typename KeyB>
+auto project(const RangeA& a, KeyA&& key_a, const RangeB& b, KeyB&& key_b)
+{
+    using function_type = detail::project_rows<decltype(std::cbegin(a)),
+                                               decltype(std::cbegin(b)),
+                                               std::decay_t<KeyA>,
+                                               std::decay_t<KeyB>>;
+    return gather_closure<function_type>{{std::cbegin(a), std::cbegin(b),
+                                          std::forward<KeyA>(key_a),
+                                          std::forward<KeyB>(key_b)}};
+}
+
+template <typename Enumerable, typename Function>
+auto operator%(const Enumerable& range, const gather_closure<Function>& gather)
+{
+    using iterator_type = gather_iterator<decltype(std::cbegin(range)), Function>;
+    return enumerable<iterator_type>{
+        { std::cbegin(range), gather.fn },
+        { std::cend(range), gather.fn }};
+}
+
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <cinq/enumerable.hpp>
+#include <cinq/hash_table.hpp>
+#include <cinq/key.hpp>
+#include <cinq/where.hpp>
+
+namespace cinq
+{
+
+//
+// Semi-join and anti-join: keep the elements of the left input that have
+// (semi_join) or do not have (anti_join) at least one match in the given
+// range. Both are filters over the left input, so the result is the
+// where-enumerable of the left input and every element appears at most once,
+// however many matches it has.
+//
+
+template <typename Enumerable, typename Filter, bool Anti>
+struct semi_join_on_closure
+{
+    const Enumerable& range;
+    Filter filter;
+};
+
+template <typename Enumerable, typename KeyA, typename KeyB, bool Anti>
+struct semi_join_on_keys_closure
+{
+    const Enumerable& range;
+    KeyA key_a;
+    KeyB key_b;
+};
+
+template <typename Enumerable, bool Anti>
+class semi_join_closure
+{
+public:
+    semi_join_closure(const Enumerable& range) noexcept
+        : _range{range}
+    {}
+
+    /**
+     * Matches by an arbitrary predicate on (left, right) elements; every left
+     * element scans the range until its first match.
+     */
+    template <typename Filter>
+    semi_join_on_closure<Enumerable, std::decay_t<Filter>, Anti>
+    on(Filter&& filter) const
+    {
+        return {_range, std::forward<Filter>(filter)};
+    }
+
+    /**
+     * Matches by key equality against a hash set of the range's keys, built
+     * once before filtering.
+     */
+    template <typename KeyA, typename KeyB>
+    semi_join_on_keys_closure<Enumerable, std::decay_t<KeyA>,
+                              std::decay_t<KeyB>, Anti>
+    on_keys(KeyA&& key_a, KeyB&& key_b) const
+    {
+        return {_range, std::forward<KeyA>(key_a), std::forward<KeyB>(key_b)};
+    }
+
+private:
+    const Enumerable& _range;
+};
+
+template <typename Enumerable>
+semi_join_closure<Enumerable, false> semi_join(const Enumerable& range) noexcept
+{
+    return {range};
+}
+
+template <typename Enumerable>
+semi_join_closure<Enumerable, true> anti_join(const Enumerable& range) noexcept
+{
+    return {range};
+}
+
+template <typename EnumerableFrom, typename EnumerableJoinOn, typename Filter,
+          bool Anti>
+auto operator%(const EnumerableFrom& range,
+               const semi_join_on_closure<EnumerableJoinOn, Filter, Anti>& closure)
+{
+    auto begin = std::cbegin(closure.range);
+    auto end = std::cend(closure.range);
+    auto pred = [begin, end, filter = closure.filter](const auto& a)
+    {
+        return Anti == std::none_of(begin, end, [&](const auto& b)
+                                    { return filter(a, b); });
+    };
+    return range % where(std::move(pred));
+}
+
+template <typename EnumerableFrom, typename EnumerableJoinOn,
+          typename KeyA, typename KeyB, bool Anti>
+auto operator%(const EnumerableFrom& range,
+               const semi_join_on_keys_closure<EnumerableJoinOn, KeyA, KeyB,
+                                               Anti>& closure)
+{
+    using value_type1 = detail::value_t<decltype(std::cbegin(range))>;
+    using value_type2 = detail::value_t<decltype(std::cbegin(closure.range))>;
+    using key_type = std::common_type_t<detail::key_t<KeyA, value_type1>,
+                                        detail::key_t<KeyB, value_type2>>;
+
+    auto begin = std::cbegin(closure.range);
+    auto end = std::cend(closure.range);
+    auto size = detail::size_hint(begin, end);
+    auto keys = std::make_shared<detail::key_set<key_type>>(
+            size != detail::npos_size ? size : 0);
+    for (; begin != end; ++begin)
+        keys->insert(detail::invoke_key(closure.key_b, *begin));
+
+    auto pred = [keys = std::shared_ptr<const detail::key_set<key_type>>{keys},
+                 key_a = closure.key_a](const value_type1& a)
+    {
+        return Anti != keys->contains(detail::invoke_key(key_a, a));
+    };
+    return range % where(std::move(pred));
+}
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Kernels are written with the GCC/Clang vector extensions and compiled per
+// instruction set through target attributes, then picked at run time. Other
+// compilers fall back to portable scalar code.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CINQ_SIMD_X86 1
+#define CINQ_SIMD_TARGET(isa) __attribute__((target(isa)))
+#elif defined(__GNUC__)
+#define CINQ_SIMD_TARGET(isa)
+#endif
+
+#if defined(__GNUC__)
+#define CINQ_SIMD_VECTORS 1
+#define CINQ_SIMD_INLINE __attribute__((always_inline)) inline
+#else
+#define CINQ_SIMD_INLINE inline
+#endif
+
+#if defined(CINQ_SIMD_X86)
+#include <immintrin.h>
+#endif
+
+namespace cinq {
+
+namespace detail
+{
+
+// Instruction sets with kernels, in increasing order.
+enum class simd_isa
+{
+    scalar,
+    sse2,
+    avx2,
+    avx512
+};
+
+// Best instruction set of the running CPU, detected once.
+inline simd_isa simd_level() noexcept
+{
+#if defined(CINQ_SIMD_X86)
+    static const simd_isa level = []
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+            return simd_isa::avx512;
+        if (__builtin_cpu_supports("avx2"))
+            return simd_isa::avx2;
+        if (__builtin_cpu_supports("sse2"))
+            return simd_isa::sse2;
+        return simd_isa::scalar;
+    }();
+    return level;
+#else
+    return simd_isa::scalar;
+#endif
+}
+
+#if defined(CINQ_SIMD_VECTORS)
+// Vector of Bytes / sizeof(T) lanes of T.
+template <typename T, std::size_t Bytes>
+struct simd_vector
+{
+    typedef T type __attribute__((vector_size(Bytes)));
+};
+
+template <typename T, std::size_t Bytes>
+using simd_t = typename simd_vector<T, Bytes>::type;
+
+// Unaligned load. Vectors are passed by reference, as passing them by value
+// between functions compiled for different instruction sets changes the ABI.
+template <typename V, typename T>
+CINQ_SIMD_INLINE void simd_load(V& v, const T* p) noexcept
+{
+    std::memcpy(&v, p, sizeof(V));
+}
+#endif
+
+//
+// Iterators over arithmetic elements stored contiguously in memory: pointers
+// and std::vector iterators. Those of std::array are pointers in all major
+// standard libraries.
+//
+template <typename Iterator, typename = void>
+struct is_contiguous : std::false_type {};
+
+template <typename T>
+struct is_contiguous<T*> : std::true_type {};
+
+template <typename Iterator>
+struct is_contiguous<Iterator, std::enable_if_t<
+        std::is_arithmetic<typename std::iterator_traits<Iterator>::value_type>::value &&
+        !std::is_pointer<Iterator>::value>>
+    : std::integral_constant<bool,
+        std::is_same<Iterator, typename std::vector<typename std::iterator_traits<Iterator>::value_type>::iterator>::value ||
+        std::is_same<Iterator, typename std::vector<typename std::iterator_traits<Iterator>::value_type>::const_iterator>::value> {};
+
+// vector<bool> packs its elements into bits.
+template <>
+struct is_contiguous<std::vector<bool>::iterator> : std::false_type {};
+
+template <>
+struct is_contiguous<std::vector<bool>::const_iterator> : std::false_type {};
+
+// Address of the first element of a non-empty contiguous range.
+template <typename Iterator>
+const typename std::iterator_traits<Iterator>::value_type*
+contiguous_data(const Iterator& it) noexcept
+{
+    return std::addressof(*it);
+}
+
+}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+namespace cinq
+{
+
+/**
+ * Counters filled in by join operators that are given a pointer to it, as
+ * the work they count is done. Applying the join with operator% builds its
+ * table and seeks the first result row, so a join that is never iterated
+ * already reports that much; the probe counters are complete only once the
+ * result has been consumed.
+ */
+struct join_statistics
+{
+    // Elements inserted into the build side hash table.
+    std::size_t build_rows = 0;
+    // Probe side elements tested against the Bloom filter, and those of them
+    // it rejected.
+    std::size_t bloom_checks = 0;
+    std::size_t bloom_rejects = 0;
+
+    // Share of probe side elements discarded by the Bloom filter.
+    double filter_rate() const noexcept
+    {
+        return bloom_checks == 0
+                ? 0.0
+                : static_cast<double>(bloom_rejects) / bloom_checks;
+    }
+};
+
+}
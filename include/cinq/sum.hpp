@@ -1,55 +1,1191 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include <cinq/enumerable.hpp>
+#include <cinq/parallel.hpp>
+#include <cinq/simd.hpp>
+#include <cinq/where.hpp>
 
 namespace cinq
 {
 
+/**
+ * Mode of sum<precise>(): floating point elements are added with compensated
+ * summation, which carries the rounding error of every addition along and
+ * gives a result as accurate as if summed at twice the precision. Other
+ * elements are summed as usual, as their sums are exact.
+ */
+struct precise {};
+
 namespace detail
 {
+    // Element types summed by the vector kernels. Their sum in the vector
+    // lanes is the same as one element at a time for integers, and differs
+    // only by rounding for floating point.
+    template <typename T>
+    using has_simd_sum = std::integral_constant<bool,
+            std::is_arithmetic<T>::value &&
+            !std::is_same<T, bool>::value &&
+            !std::is_same<T, long double>::value>;
+
+    // Four independent accumulators, so that consecutive additions do not
+    // wait on each other.
+    template <typename T>
+    T scalar_sum(const T* p, std::size_t n) noexcept
+    {
+        T a0{}, a1{}, a2{}, a3{};
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            a0 += p[i];
+            a1 += p[i + 1];
+            a2 += p[i + 2];
+            a3 += p[i + 3];
+        }
+        for (; i < n; ++i)
+            a0 += p[i];
+        return (a0 + a1) + (a2 + a3);
+    }
+
+#if defined(CINQ_SIMD_VECTORS)
+    // Four independent accumulators of Bytes each, for as many loads in
+    // flight as the core can issue.
+    template <typename T, std::size_t Bytes>
+    CINQ_SIMD_INLINE T simd_sum_lanes(const T* p, std::size_t n) noexcept
+    {
+        using V = simd_t<T, Bytes>;
+        constexpr std::size_t width = Bytes / sizeof(T);
+        V a0{}, a1{}, a2{}, a3{};
+        V x0, x1, x2, x3;
+        std::size_t i = 0;
+        for (; i + 4 * width <= n; i += 4 * width)
+        {
+            simd_load(x0, p + i);
+            simd_load(x1, p + i + width);
+            simd_load(x2, p + i + 2 * width);
+            simd_load(x3, p + i + 3 * width);
+            a0 += x0;
+            a1 += x1;
+            a2 += x2;
+            a3 += x3;
+        }
+        for (; i + width <= n; i += width)
+        {
+            simd_load(x0, p + i);
+            a0 += x0;
+        }
+        a0 = (a0 + a1) + (a2 + a3);
+
+        T sum{};
+        for (std::size_t lane = 0; lane < width; ++lane)
+            sum += a0[lane];
+        for (; i < n; ++i)
+            sum += p[i];
+        return sum;
+    }
+
+    template <typename T>
+    T simd_sum_sse2(const T* p, std::size_t n) noexcept
+    {
+        return simd_sum_lanes<T, 16>(p, n);
+    }
+
+#if defined(CINQ_SIMD_X86)
+    template <typename T>
+    CINQ_SIMD_TARGET("avx2")
+    T simd_sum_avx2(const T* p, std::size_t n) noexcept
+    {
+        return simd_sum_lanes<T, 32>(p, n);
+    }
+
+    template <typename T>
+    CINQ_SIMD_TARGET("avx512f,avx512bw")
+    T simd_sum_avx512(const T* p, std::size_t n) noexcept
+    {
+        return simd_sum_lanes<T, 64>(p, n);
+    }
+#endif
+#endif
+
+    // Sum of n contiguous elements with the kernel for the given instruction
+    // set, which the CPU must support.
+    template <typename T>
+    T simd_sum(const T* p, std::size_t n, simd_isa isa = simd_level()) noexcept
+    {
+        switch (isa)
+        {
+#if defined(CINQ_SIMD_X86)
+        case simd_isa::avx512: return simd_sum_avx512(p, n);
+        case simd_isa::avx2: return simd_sum_avx2(p, n);
+#endif
+#if defined(CINQ_SIMD_VECTORS)
+        case simd_isa::sse2: return simd_sum_sse2(p, n);
+#endif
+        default: return scalar_sum(p, n);
+        }
+    }
+
+    template <typename T>
+    T sum_contiguous(const T* begin, const T* end, std::true_type)
+    {
+        return simd_sum(begin, static_cast<std::size_t>(end - begin));
+    }
+
+    template <typename T>
+    T sum_contiguous(const T* begin, const T* end, std::false_type)
+    {
+        return std::accumulate(begin, end, T{});
+    }
+
+    // x if keep, else zero. Integers are masked explicitly, as compilers turn
+    // the conditional back into a branch; floating point keeps the select,
+    // which they vectorize and which unlike a multiplication by zero does not
+    // let infinite or NaN elements through.
+    template <typename T>
+    CINQ_SIMD_INLINE std::enable_if_t<std::is_integral<T>::value, T>
+    select_if(bool keep, T x) noexcept
+    {
+        return static_cast<T>(x & -static_cast<T>(keep));
+    }
+
+    template <typename T>
+    CINQ_SIMD_INLINE std::enable_if_t<!std::is_integral<T>::value, T>
+    select_if(bool keep, T x) noexcept
+    {
+        return keep ? x : T{};
+    }
+
+    //
+    // Sum of the elements satisfying pred, without branching on it: every
+    // lane adds either its element or zero, and the lanes are independent
+    // accumulators, so that the loop vectorizes whenever the predicate
+    // inlines to plain arithmetic.
+    //
+    template <typename T, std::size_t Lanes, typename Predicate>
+    CINQ_SIMD_INLINE T masked_sum_lanes(const T* p, std::size_t n,
+                                        const Predicate& pred)
+    {
+        T acc[Lanes] = {};
+        std::size_t i = 0;
+        for (; i + Lanes <= n; i += Lanes)
+        {
+            for (std::size_t lane = 0; lane < Lanes; ++lane)
+            {
+                const T x = p[i + lane];
+                acc[lane] += select_if(pred(x), x);
+            }
+        }
+        T sum{};
+        for (std::size_t lane = 0; lane < Lanes; ++lane)
+            sum += acc[lane];
+        for (; i < n; ++i)
+        {
+            if (pred(p[i]))
+                sum += p[i];
+        }
+        return sum;
+    }
+
+    // Two vectors of lanes per step for every instruction set.
+    template <typename T, typename Predicate>
+    T masked_sum_sse2(const T* p, std::size_t n, const Predicate& pred)
+    {
+        return masked_sum_lanes<T, 32 / sizeof(T)>(p, n, pred);
+    }
+
+#if defined(CINQ_SIMD_X86)
+    template <typename T, typename Predicate>
+    CINQ_SIMD_TARGET("avx2")
+    T masked_sum_avx2(const T* p, std::size_t n, const Predicate& pred)
+    {
+        return masked_sum_lanes<T, 64 / sizeof(T)>(p, n, pred);
+    }
+
+    template <typename T, typename Predicate>
+    CINQ_SIMD_TARGET("avx512f,avx512bw")
+    T masked_sum_avx512(const T* p, std::size_t n, const Predicate& pred)
+    {
+        return masked_sum_lanes<T, 128 / sizeof(T)>(p, n, pred);
+    }
+#endif
+
+    template <typename T, typename Predicate>
+    T masked_sum(const T* p, std::size_t n, const Predicate& pred,
+                 simd_isa isa = simd_level())
+    {
+        switch (isa)
+        {
+#if defined(CINQ_SIMD_X86)
+        case simd_isa::avx512: return masked_sum_avx512(p, n, pred);
+        case simd_isa::avx2: return masked_sum_avx2(p, n, pred);
+#endif
+        default: return masked_sum_sse2(p, n, pred);
+        }
+    }
+
     template <typename InputIterator>
-    auto sum_range(InputIterator begin, InputIterator end)
+    auto sum_range(InputIterator begin, InputIterator end, std::false_type)
     {
         return std::accumulate(begin, end,
                 typename InputIterator::value_type{});
     }
 
+    template <typename InputIterator>
+    auto sum_range(InputIterator begin, InputIterator end, std::true_type)
+    {
+        using value_type = typename std::iterator_traits<InputIterator>::value_type;
+        if (begin == end)
+            return value_type{};
+        const auto* first = contiguous_data(begin);
+        return sum_contiguous(first, first + (end - begin),
+                              has_simd_sum<value_type>{});
+    }
+
+    template <typename InputIterator>
+    auto sum_range(InputIterator begin, InputIterator end)
+    {
+        return sum_range(begin, end, is_contiguous<InputIterator>{});
+    }
+
+    template <typename Iterator, typename Predicate>
+    auto sum_range(where_iterator<Iterator, Predicate> begin,
+                   where_iterator<Iterator, Predicate> end, std::true_type)
+    {
+        using value_type = typename std::iterator_traits<Iterator>::value_type;
+        if (begin == end)
+            return value_type{};
+        const auto* first = contiguous_data(begin.base());
+        return masked_sum(first, static_cast<std::size_t>(
+                                  begin.base_end() - begin.base()),
+                          begin.predicate());
+    }
+
+    // A where stage directly over a contiguous range is summed by a fused
+    // masked loop over that range instead of through the where_iterator.
+    template <typename Iterator, typename Predicate>
+    auto sum_range(where_iterator<Iterator, Predicate> begin,
+                   where_iterator<Iterator, Predicate> end)
+    {
+        using value_type = typename std::iterator_traits<Iterator>::value_type;
+        return sum_range(begin, end, std::integral_constant<bool,
+                is_contiguous<Iterator>::value &&
+                has_simd_sum<value_type>::value>{});
+    }
+
     template <typename T>
     auto sum_range(T* begin, T* end)
     {
-        return std::accumulate(begin, end, T{});
+        return sum_contiguous<std::remove_cv_t<T>>(
+                begin, end, has_simd_sum<std::remove_cv_t<T>>{});
+    }
+
+    // Adds x to sum and the rounding error of that addition to comp. The
+    // error is recovered exactly whatever the magnitudes (Knuth's TwoSum),
+    // without comparisons, so that the same code serves scalars and vectors.
+    template <typename T>
+    CINQ_SIMD_INLINE void two_sum_add(T& sum, T& comp, const T& x) noexcept
+    {
+        const T t = sum + x;
+        const T z = t - sum;
+        comp += (sum - (t - z)) + (x - z);
+        sum = t;
+    }
+
+    // A compensated sum in progress: the rounded sum and the error it
+    // accumulated, kept apart until value() so that partial sums can be
+    // added up without losing what each one carries.
+    template <typename T>
+    struct compensated
+    {
+        void add(T x) noexcept { two_sum_add(sum, comp, x); }
+        T value() const noexcept { return sum + comp; }
+
+        T sum{};
+        T comp{};
+    };
+
+    // Adds up the sums first, as the error terms of sums that cancel each
+    // other out can be far larger than what remains.
+    template <typename T, typename InputIterator>
+    compensated<T> merge_compensated(InputIterator begin, InputIterator end)
+    {
+        compensated<T> total;
+        for (auto it = begin; it != end; ++it)
+            total.add(it->sum);
+        for (auto it = begin; it != end; ++it)
+            total.add(it->comp);
+        return total;
+    }
+
+    struct keep_all
+    {
+        template <typename T>
+        constexpr bool operator()(const T&) const noexcept { return true; }
+    };
+
+    //
+    // Compensated sum of the elements satisfying pred, with a sum and an
+    // error term per lane over two vectors of Bytes, masked as in
+    // masked_sum_lanes.
+    //
+    template <typename T, std::size_t Bytes, typename Predicate>
+    CINQ_SIMD_INLINE compensated<T> precise_sum_lanes(const T* p, std::size_t n,
+                                                      const Predicate& pred)
+    {
+        constexpr std::size_t lanes = 2 * Bytes / sizeof(T);
+        compensated<T> acc[lanes];
+        T sum[lanes] = {};
+        T comp[lanes] = {};
+        std::size_t i = 0;
+        for (; i + lanes <= n; i += lanes)
+        {
+            for (std::size_t lane = 0; lane < lanes; ++lane)
+            {
+                const T x = select_if(pred(p[i + lane]), p[i + lane]);
+                two_sum_add(sum[lane], comp[lane], x);
+            }
+        }
+        for (std::size_t lane = 0; lane < lanes; ++lane)
+            acc[lane] = {sum[lane], comp[lane]};
+        auto total = merge_compensated<T>(acc, acc + lanes);
+        for (; i < n; ++i)
+        {
+            if (pred(p[i]))
+                total.add(p[i]);
+        }
+        return total;
+    }
+
+#if defined(CINQ_SIMD_VECTORS)
+    // Unfiltered, four vector accumulators each with their own error term,
+    // as in simd_sum_lanes. The additions recovering the errors are off the
+    // dependency chain, so the loop is bound by arithmetic in cache, at about
+    // three times the plain sum, and close to it on data from memory.
+    template <typename T, std::size_t Bytes>
+    CINQ_SIMD_INLINE compensated<T> precise_sum_lanes(const T* p, std::size_t n,
+                                                      const keep_all&)
+    {
+        using V = simd_t<T, Bytes>;
+        constexpr std::size_t width = Bytes / sizeof(T);
+        V s0{}, s1{}, s2{}, s3{};
+        V c0{}, c1{}, c2{}, c3{};
+        V x0, x1, x2, x3;
+        std::size_t i = 0;
+        for (; i + 4 * width <= n; i += 4 * width)
+        {
+            simd_load(x0, p + i);
+            simd_load(x1, p + i + width);
+            simd_load(x2, p + i + 2 * width);
+            simd_load(x3, p + i + 3 * width);
+            two_sum_add(s0, c0, x0);
+            two_sum_add(s1, c1, x1);
+            two_sum_add(s2, c2, x2);
+            two_sum_add(s3, c3, x3);
+        }
+
+        compensated<T> acc[4 * width];
+        for (std::size_t lane = 0; lane < width; ++lane)
+        {
+            acc[lane] = {s0[lane], c0[lane]};
+            acc[width + lane] = {s1[lane], c1[lane]};
+            acc[2 * width + lane] = {s2[lane], c2[lane]};
+            acc[3 * width + lane] = {s3[lane], c3[lane]};
+        }
+        auto total = merge_compensated<T>(acc, acc + 4 * width);
+        for (; i < n; ++i)
+            total.add(p[i]);
+        return total;
+    }
+#endif
+
+    template <typename T, typename Predicate>
+    compensated<T> precise_sum_sse2(const T* p, std::size_t n,
+                                    const Predicate& pred)
+    {
+        return precise_sum_lanes<T, 16>(p, n, pred);
+    }
+
+#if defined(CINQ_SIMD_X86)
+    template <typename T, typename Predicate>
+    CINQ_SIMD_TARGET("avx2")
+    compensated<T> precise_sum_avx2(const T* p, std::size_t n,
+                                    const Predicate& pred)
+    {
+        return precise_sum_lanes<T, 32>(p, n, pred);
+    }
+
+    template <typename T, typename Predicate>
+    CINQ_SIMD_TARGET("avx512f,avx512bw")
+    compensated<T> precise_sum_avx512(const T* p, std::size_t n,
+                                      const Predicate& pred)
+    {
+        return precise_sum_lanes<T, 64>(p, n, pred);
+    }
+#endif
+
+    template <typename T, typename Predicate = keep_all>
+    compensated<T> precise_sum(const T* p, std::size_t n,
+                               const Predicate& pred = {},
+                               simd_isa isa = simd_level())
+    {
+        switch (isa)
+        {
+#if defined(CINQ_SIMD_X86)
+        case simd_isa::avx512: return precise_sum_avx512(p, n, pred);
+        case simd_isa::avx2: return precise_sum_avx2(p, n, pred);
+#endif
+        default: return precise_sum_sse2(p, n, pred);
+        }
+    }
+
+    template <typename InputIterator>
+    auto compensated_sum(InputIterator begin, InputIterator end, std::false_type)
+    {
+        compensated<typename std::iterator_traits<InputIterator>::value_type> total;
+        for (; begin != end; ++begin)
+            total.add(*begin);
+        return total;
+    }
+
+    template <typename InputIterator>
+    auto compensated_sum(InputIterator begin, InputIterator end, std::true_type)
+    {
+        using value_type = typename std::iterator_traits<InputIterator>::value_type;
+        if (begin == end)
+            return compensated<value_type>{};
+        return precise_sum(contiguous_data(begin),
+                           static_cast<std::size_t>(end - begin));
+    }
+
+    template <typename Iterator, typename Predicate>
+    auto compensated_sum(where_iterator<Iterator, Predicate> begin,
+                         where_iterator<Iterator, Predicate> end, std::true_type)
+    {
+        using value_type = typename std::iterator_traits<Iterator>::value_type;
+        if (begin == end)
+            return compensated<value_type>{};
+        return precise_sum(contiguous_data(begin.base()),
+                           static_cast<std::size_t>(
+                                   begin.base_end() - begin.base()),
+                           begin.predicate());
+    }
+
+    // Integers and other exactly summed elements.
+    template <typename InputIterator>
+    auto precise_sum_range(InputIterator begin, InputIterator end,
+                           std::false_type)
+    {
+        return sum_range(begin, end);
+    }
+
+    template <typename InputIterator>
+    auto precise_sum_range(InputIterator begin, InputIterator end,
+                           std::true_type)
+    {
+        using value_type = typename std::iterator_traits<InputIterator>::value_type;
+        return compensated_sum(begin, end, std::integral_constant<bool,
+                is_contiguous<InputIterator>::value &&
+                has_simd_sum<value_type>::value>{});
+    }
+
+    template <typename Iterator, typename Predicate>
+    auto precise_sum_range(where_iterator<Iterator, Predicate> begin,
+                           where_iterator<Iterator, Predicate> end,
+                           std::true_type)
+    {
+        using value_type = typename std::iterator_traits<Iterator>::value_type;
+        return compensated_sum(begin, end, std::integral_constant<bool,
+                is_contiguous<Iterator>::value &&
+                has_simd_sum<value_type>::value>{});
+    }
+
+    // Compensated sum of floating point elements, plain sum of others.
+    template <typename InputIterator>
+    auto precise_sum_range(InputIterator begin, InputIterator end)
+    {
+        using value_type = typename std::iterator_traits<InputIterator>::value_type;
+        return precise_sum_range(begin, end,
+                                 std::is_floating_point<value_type>{});
+    }
+
+    template <typename T>
+    T sum_value(const compensated<T>& sum) noexcept { return sum.value(); }
+
+    template <typename T>
+    T sum_value(T sum) { return sum; }
+
+    // Elements summed exactly by the widening kernels: the size of 8 and 16
+    // bit integers, and 0 for those summed lane by lane in the accumulator
+    // type.
+    template <typename T>
+    using widening_kind = std::integral_constant<std::size_t,
+            std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+            sizeof(T) <= 2 ? sizeof(T) : 0>;
+
+    // Each element converted to Acc and added to one of Lanes accumulators,
+    // which the compiler vectorizes with widening conversions.
+    template <typename Acc, std::size_t Lanes, typename T>
+    CINQ_SIMD_INLINE Acc widening_sum_lanes(const T* p, std::size_t n) noexcept
+    {
+        Acc acc[Lanes] = {};
+        const T* const tail = p + n / Lanes * Lanes;
+        for (; p != tail; p += Lanes)
+        {
+            for (std::size_t lane = 0; lane < Lanes; ++lane)
+                acc[lane] += static_cast<Acc>(p[lane]);
+        }
+        Acc sum{};
+        for (std::size_t lane = 0; lane < Lanes; ++lane)
+            sum += acc[lane];
+        // Bounded by n % Lanes, which lets the compiler see the tail is short.
+        for (std::size_t i = 0; i < n % Lanes; ++i)
+            sum += static_cast<Acc>(p[i]);
+        return sum;
+    }
+
+    template <typename Acc, std::size_t Bytes, typename T>
+    CINQ_SIMD_INLINE Acc widening_sum_lanes(const T* p, std::size_t n,
+                                            std::integral_constant<std::size_t, 0>) noexcept
+    {
+        return widening_sum_lanes<Acc, 2 * Bytes / sizeof(Acc)>(p, n);
+    }
+
+#if defined(CINQ_SIMD_X86)
+    // Sums of each eight bytes into 64-bit lanes (psadbw against zero). The
+    // intrinsics only inline into functions targeting their instruction set,
+    // so these are plain inline functions, inlined in turn into the kernels
+    // once those are inlined into their target wrappers.
+    CINQ_SIMD_TARGET("sse2") inline
+    void sum_bytes(simd_t<std::uint64_t, 16>& sums,
+                   const simd_t<std::uint8_t, 16>& x) noexcept
+    {
+        sums = (simd_t<std::uint64_t, 16>)_mm_sad_epu8(
+                (__m128i)x, _mm_setzero_si128());
+    }
+
+    CINQ_SIMD_TARGET("avx2") inline
+    void sum_bytes(simd_t<std::uint64_t, 32>& sums,
+                   const simd_t<std::uint8_t, 32>& x) noexcept
+    {
+        sums = (simd_t<std::uint64_t, 32>)_mm256_sad_epu8(
+                (__m256i)x, _mm256_setzero_si256());
+    }
+
+    CINQ_SIMD_TARGET("avx512f,avx512bw") inline
+    void sum_bytes(simd_t<std::uint64_t, 64>& sums,
+                   const simd_t<std::uint8_t, 64>& x) noexcept
+    {
+        sums = (simd_t<std::uint64_t, 64>)_mm512_sad_epu8(
+                (__m512i)x, _mm512_setzero_si512());
+    }
+
+    // Sums of each two 16-bit lanes into 32-bit lanes (pmaddwd by one).
+    CINQ_SIMD_TARGET("sse2") inline
+    void sum_pairs(simd_t<std::int32_t, 16>& sums,
+                   const simd_t<std::int16_t, 16>& x) noexcept
+    {
+        sums = (simd_t<std::int32_t, 16>)_mm_madd_epi16(
+                (__m128i)x, _mm_set1_epi16(1));
+    }
+
+    CINQ_SIMD_TARGET("avx2") inline
+    void sum_pairs(simd_t<std::int32_t, 32>& sums,
+                   const simd_t<std::int16_t, 32>& x) noexcept
+    {
+        sums = (simd_t<std::int32_t, 32>)_mm256_madd_epi16(
+                (__m256i)x, _mm256_set1_epi16(1));
+    }
+
+    CINQ_SIMD_TARGET("avx512f,avx512bw") inline
+    void sum_pairs(simd_t<std::int32_t, 64>& sums,
+                   const simd_t<std::int16_t, 64>& x) noexcept
+    {
+        sums = (simd_t<std::int32_t, 64>)_mm512_madd_epi16(
+                (__m512i)x, _mm512_set1_epi16(1));
+    }
+
+    //
+    // Exact sum of bytes. Signed bytes are biased to unsigned by flipping
+    // their sign bit, and the bias taken off the total; the 64-bit lane
+    // sums cannot overflow.
+    //
+    template <typename Acc, std::size_t Bytes, typename T>
+    CINQ_SIMD_INLINE Acc widening_sum_lanes(const T* p, std::size_t n,
+                                            std::integral_constant<std::size_t, 1>) noexcept
+    {
+        using V = simd_t<std::uint8_t, Bytes>;
+        using W = simd_t<std::uint64_t, Bytes>;
+        constexpr std::uint8_t bias = std::is_signed<T>::value ? 0x80 : 0;
+        W a0{}, a1{}, s0, s1;
+        V x0, x1;
+        std::size_t i = 0;
+        for (; i + 2 * Bytes <= n; i += 2 * Bytes)
+        {
+            simd_load(x0, p + i);
+            simd_load(x1, p + i + Bytes);
+            sum_bytes(s0, x0 ^ bias);
+            sum_bytes(s1, x1 ^ bias);
+            a0 += s0;
+            a1 += s1;
+        }
+        a0 += a1;
+
+        std::uint64_t sum = 0;
+        for (std::size_t lane = 0; lane < Bytes / 8; ++lane)
+            sum += a0[lane];
+        for (; i < n; ++i)
+            sum += static_cast<std::uint8_t>(p[i]) ^ bias;
+        return static_cast<Acc>(static_cast<std::int64_t>(sum) -
+                                static_cast<std::int64_t>(bias * n));
+    }
+
+    //
+    // Exact sum of 16-bit integers, biased to signed for unsigned elements.
+    // A 32-bit lane gains at most 2^16 per step, so the lanes are moved to
+    // the 64-bit total every 2^14 steps, before they can overflow.
+    //
+    template <typename Acc, std::size_t Bytes, typename T>
+    CINQ_SIMD_INLINE Acc widening_sum_lanes(const T* p, std::size_t n,
+                                            std::integral_constant<std::size_t, 2>) noexcept
+    {
+        using V = simd_t<std::int16_t, Bytes>;
+        using W = simd_t<std::int32_t, Bytes>;
+        constexpr std::size_t width = Bytes / 2;
+        constexpr std::size_t flush_steps = std::size_t{1} << 14;
+        constexpr std::int16_t bias = std::is_signed<T>::value ? 0 : -0x8000;
+        std::int64_t sum = 0;
+        std::size_t i = 0;
+        while (i + 2 * width <= n)
+        {
+            const auto stop = std::min(n, i + flush_steps * 2 * width);
+            W a0{}, a1{}, s0, s1;
+            V x0, x1;
+            for (; i + 2 * width <= stop; i += 2 * width)
+            {
+                simd_load(x0, p + i);
+                simd_load(x1, p + i + width);
+                sum_pairs(s0, x0 ^ bias);
+                sum_pairs(s1, x1 ^ bias);
+                a0 += s0;
+                a1 += s1;
+            }
+            for (std::size_t lane = 0; lane < width / 2; ++lane)
+                sum += std::int64_t{a0[lane]} + a1[lane];
+        }
+        for (; i < n; ++i)
+            sum += static_cast<std::int16_t>(p[i] ^ bias);
+        return static_cast<Acc>(sum - std::int64_t{bias} *
+                                static_cast<std::int64_t>(n));
+    }
+
+    template <typename Acc, typename T>
+    CINQ_SIMD_TARGET("sse2")
+    Acc widening_sum_sse2(const T* p, std::size_t n) noexcept
+    {
+        return widening_sum_lanes<Acc, 16>(p, n, widening_kind<T>{});
+    }
+
+    template <typename Acc, typename T>
+    CINQ_SIMD_TARGET("avx2")
+    Acc widening_sum_avx2(const T* p, std::size_t n) noexcept
+    {
+        return widening_sum_lanes<Acc, 32>(p, n, widening_kind<T>{});
+    }
+
+    template <typename Acc, typename T>
+    CINQ_SIMD_TARGET("avx512f,avx512bw")
+    Acc widening_sum_avx512(const T* p, std::size_t n) noexcept
+    {
+        return widening_sum_lanes<Acc, 64>(p, n, widening_kind<T>{});
+    }
+#endif
+
+    // Sum of n contiguous elements in an accumulator of type Acc.
+    template <typename Acc, typename T>
+    Acc widening_sum(const T* p, std::size_t n, simd_isa isa = simd_level()) noexcept
+    {
+        switch (isa)
+        {
+#if defined(CINQ_SIMD_X86)
+        case simd_isa::avx512: return widening_sum_avx512<Acc>(p, n);
+        case simd_isa::avx2: return widening_sum_avx2<Acc>(p, n);
+        case simd_isa::sse2: return widening_sum_sse2<Acc>(p, n);
+#endif
+        default: return widening_sum_lanes<Acc, 4>(p, n);
+        }
+    }
+
+    template <typename Acc, typename InputIterator>
+    Acc widening_sum_range(InputIterator begin, InputIterator end, std::false_type)
+    {
+        return std::accumulate(begin, end, Acc{});
+    }
+
+    template <typename Acc, typename InputIterator>
+    Acc widening_sum_range(InputIterator begin, InputIterator end, std::true_type)
+    {
+        if (begin == end)
+            return Acc{};
+        return widening_sum<Acc>(contiguous_data(begin),
+                                 static_cast<std::size_t>(end - begin));
+    }
+
+    template <typename Acc, typename InputIterator>
+    Acc widening_sum_range(InputIterator begin, InputIterator end)
+    {
+        using value_type = typename std::iterator_traits<InputIterator>::value_type;
+        return widening_sum_range<Acc>(begin, end, std::integral_constant<bool,
+                is_contiguous<InputIterator>::value &&
+                has_simd_sum<value_type>::value &&
+                has_simd_sum<Acc>::value>{});
+    }
+
+    //
+    // How sum<Mode>() sums a range: partial() sums a slice of it, combine()
+    // adds up the partial sums of its slices in order, and range() sums it
+    // whole.
+    //
+    template <typename Mode, typename = void>
+    struct summation;
+
+    template <>
+    struct summation<void>
+    {
+        template <typename InputIterator>
+        static auto partial(InputIterator begin, InputIterator end)
+        {
+            return sum_range(begin, end);
+        }
+
+        template <typename T>
+        static T combine(const std::vector<T>& partial)
+        {
+            return std::accumulate(partial.begin(), partial.end(), T{});
+        }
+
+        template <typename T>
+        static T merge(const T& a, const T& b) { return a + b; }
+
+        template <typename T>
+        static T value(const T& partial) { return partial; }
+
+        template <typename InputIterator>
+        static auto range(InputIterator begin, InputIterator end)
+        {
+            return sum_range(begin, end);
+        }
+    };
+
+    template <>
+    struct summation<precise>
+    {
+        template <typename InputIterator>
+        static auto partial(InputIterator begin, InputIterator end)
+        {
+            return precise_sum_range(begin, end);
+        }
+
+        template <typename T>
+        static T combine(const std::vector<compensated<T>>& partial)
+        {
+            return merge_compensated<T>(partial.begin(), partial.end()).value();
+        }
+
+        template <typename T>
+        static T combine(const std::vector<T>& partial)
+        {
+            return std::accumulate(partial.begin(), partial.end(), T{});
+        }
+
+        template <typename T>
+        static compensated<T> merge(const compensated<T>& a, const compensated<T>& b)
+        {
+            const compensated<T> partial[] = {a, b};
+            return merge_compensated<T>(partial, partial + 2);
+        }
+
+        template <typename T>
+        static T merge(const T& a, const T& b) { return a + b; }
+
+        template <typename T>
+        static auto value(const T& partial) { return sum_value(partial); }
+
+        template <typename InputIterator>
+        static auto range(InputIterator begin, InputIterator end)
+        {
+            return sum_value(precise_sum_range(begin, end));
+        }
+    };
+
+    template <typename Acc>
+    struct summation<Acc, std::enable_if_t<std::is_arithmetic<Acc>::value>>
+    {
+        template <typename InputIterator>
+        static Acc partial(InputIterator begin, InputIterator end)
+        {
+            return widening_sum_range<Acc>(begin, end);
+        }
+
+        static Acc combine(const std::vector<Acc>& partial)
+        {
+            return std::accumulate(partial.begin(), partial.end(), Acc{});
+        }
+
+        static Acc merge(Acc a, Acc b) { return a + b; }
+        static Acc value(Acc partial) { return partial; }
+
+        template <typename InputIterator>
+        static Acc range(InputIterator begin, InputIterator end)
+        {
+            return widening_sum_range<Acc>(begin, end);
+        }
+    };
+}
+
+namespace detail
+{
+    //
+    // Running sum of single values in the accumulator of sum<Mode>(), for
+    // operators that add elements up one at a time.
+    //
+    template <typename Mode, typename T, typename = void>
+    struct sum_accumulator
+    {
+        using type = T;
+
+        static void add(type& sum, const T& x) { sum += x; }
+        static T value(const type& sum) { return sum; }
+    };
+
+    template <typename T>
+    struct sum_accumulator<precise, T,
+                           std::enable_if_t<std::is_floating_point<T>::value>>
+    {
+        using type = compensated<T>;
+
+        static void add(type& sum, T x) noexcept { sum.add(x); }
+        static T value(const type& sum) noexcept { return sum.value(); }
+    };
+
+    template <typename Acc, typename T>
+    struct sum_accumulator<Acc, T,
+                           std::enable_if_t<std::is_arithmetic<Acc>::value>>
+    {
+        using type = Acc;
+
+        static void add(type& sum, const T& x) { sum += static_cast<Acc>(x); }
+        static Acc value(const type& sum) { return sum; }
+    };
+}
+
+namespace detail
+{
+    // Elements below which a parallel sum task is not worth scheduling.
+    constexpr std::size_t parallel_sum_min = 64 * 1024;
+
+    //
+    // Splitting of a range into independent slices: random access ranges by
+    // position, and where stages over splittable ranges by slicing what they
+    // filter. Sizes are counted in elements of the innermost range.
+    //
+    template <typename Iterator, typename = void>
+    struct range_splitter
+    {
+        static constexpr bool splittable = false;
+    };
+
+    template <typename Iterator>
+    struct range_splitter<Iterator, std::enable_if_t<std::is_base_of<
+            std::random_access_iterator_tag,
+            typename std::iterator_traits<Iterator>::iterator_category>::value>>
+    {
+        static constexpr bool splittable = true;
+
+        static std::size_t size(const Iterator& begin, const Iterator& end)
+        {
+            return static_cast<std::size_t>(end - begin);
+        }
+
+        static std::pair<Iterator, Iterator>
+        slice(const Iterator& begin, const Iterator&,
+              std::size_t first, std::size_t last)
+        {
+            using difference_type =
+                    typename std::iterator_traits<Iterator>::difference_type;
+            return {begin + static_cast<difference_type>(first),
+                    begin + static_cast<difference_type>(last)};
+        }
+    };
+
+    template <typename Iterator, typename Predicate>
+    struct range_splitter<where_iterator<Iterator, Predicate>, std::enable_if_t<
+            range_splitter<Iterator>::splittable>>
+    {
+        using where_type = where_iterator<Iterator, Predicate>;
+        using base_splitter = range_splitter<Iterator>;
+
+        static constexpr bool splittable = true;
+
+        static std::size_t size(const where_type& begin, const where_type&)
+        {
+            return base_splitter::size(begin.base(), begin.base_end());
+        }
+
+        static std::pair<where_type, where_type>
+        slice(const where_type& begin, const where_type&,
+              std::size_t first, std::size_t last)
+        {
+            auto base = base_splitter::slice(begin.base(), begin.base_end(),
+                                             first, last);
+            return {where_type{base.first, base.second, begin.predicate()},
+                    where_type{base.second, base.second, begin.predicate()}};
+        }
+    };
+
+    template <typename Mode, typename InputIterator>
+    auto parallel_sum_range(InputIterator begin, InputIterator end,
+                            thread_pool&, std::false_type)
+    {
+        return summation<Mode>::range(begin, end);
+    }
+
+    // Sums slices on the pool and adds the partial sums in slice order, so
+    // that the result does not depend on scheduling.
+    template <typename Mode, typename InputIterator>
+    auto parallel_sum_range(InputIterator begin, InputIterator end,
+                            thread_pool& pool, std::true_type)
+    {
+        using splitter = range_splitter<InputIterator>;
+        const auto size = splitter::size(begin, end);
+        const auto tasks = std::min<std::size_t>(
+                size / parallel_sum_min, std::size_t{4} * pool.size());
+        if (tasks <= 1 || pool.size() == 1)
+            return summation<Mode>::range(begin, end);
+
+        std::vector<decltype(summation<Mode>::partial(begin, end))> partial(tasks);
+        pool.run(tasks, [&](std::size_t task, unsigned)
+        {
+            auto slice = splitter::slice(begin, end, size * task / tasks,
+                                         size * (task + 1) / tasks);
+            partial[task] = summation<Mode>::partial(slice.first, slice.second);
+        });
+        return summation<Mode>::combine(partial);
+    }
+
+    template <typename Mode, typename InputIterator>
+    auto parallel_sum_range(InputIterator begin, InputIterator end,
+                            thread_pool& pool)
+    {
+        return parallel_sum_range<Mode>(begin, end, pool,
+                std::integral_constant<bool,
+                        range_splitter<InputIterator>::splittable>{});
     }
 }
 
-class sum_tag {};
+template <typename Mode = void>
+class basic_sum_tag {};
+
+// The tag of the plain sum(), named as it was before sum modes existed.
+using sum_tag = basic_sum_tag<>;
+
+template <typename Mode = void>
+class parallel_sum_tag
+{
+public:
+    explicit parallel_sum_tag(thread_pool& pool) noexcept
+        : _pool{&pool}
+    {}
+
+    thread_pool& pool() const noexcept { return *_pool; }
+
+private:
+    thread_pool* _pool;
+};
 
-class summer_tag
+template <typename Mode = void>
+class parallel_summer_tag
 {
 public:
-    sum_tag operator()() const noexcept { return sum_tag{}; }
+    explicit parallel_summer_tag(thread_pool& pool) noexcept
+        : _pool{&pool}
+    {}
+
+    parallel_sum_tag<Mode> operator()() const noexcept
+    {
+        return parallel_sum_tag<Mode>{*_pool};
+    }
+
+private:
+    thread_pool* _pool;
 };
 
+template <typename Mode = void>
+class incremental_summer_tag {};
+
+namespace detail
+{
+    //
+    // Containers that can grow, i.e. that have push_back. Views such as an
+    // enumerable hold a fixed end, so elements appended to their source
+    // would never be summed.
+    //
+    template <typename Container, typename = void>
+    struct is_appendable : std::false_type {};
+
+    template <typename Container>
+    struct is_appendable<Container, decltype(void(
+            std::declval<Container&>().push_back(
+                    std::declval<const typename Container::value_type&>())))>
+        : std::true_type {};
+}
+
+/**
+ * Sum of an append-only container, such as a std::vector or std::deque of
+ * metrics, that remembers how many elements it has added up. Each call
+ * adds only those appended since the last one, in O(appended) time, to the
+ * sum so far. The container is referenced, so it must outlive the handle,
+ * and elements already summed must not change. It must be a container with
+ * push_back rather than a view such as an enumerable, whose end is fixed.
+ */
+template <typename Container, typename Mode = void>
+class incremental_sum
+{
+public:
+    explicit incremental_sum(const Container& container) noexcept
+        : _container{&container}
+    {}
+
+    auto operator()()
+    {
+        const auto begin = std::cbegin(*_container);
+        const auto end = std::cend(*_container);
+        const auto size = static_cast<std::size_t>(end - begin);
+        if (size > _summed)
+        {
+            using difference_type =
+                    typename std::iterator_traits<decltype(begin)>::difference_type;
+            _partial = summation::merge(_partial, summation::partial(
+                    begin + static_cast<difference_type>(_summed), end));
+            _summed = size;
+        }
+        return summation::value(_partial);
+    }
+
+    // Elements added up so far.
+    std::size_t summed() const noexcept { return _summed; }
+
+private:
+    using summation = detail::summation<Mode>;
+    using iterator = decltype(std::cbegin(std::declval<const Container&>()));
+
+    static_assert(std::is_base_of<std::random_access_iterator_tag,
+            typename std::iterator_traits<iterator>::iterator_category>::value,
+            "incremental sums need random access containers");
+
+    const Container* _container;
+    std::size_t _summed = 0;
+    decltype(summation::partial(std::declval<iterator>(), std::declval<iterator>())) _partial{};
+};
+
+template <typename Mode = void>
+class basic_summer_tag
+{
+public:
+    basic_sum_tag<Mode> operator()() const noexcept { return {}; }
+
+    /**
+     * Sum on the workers of the given pool, or of the shared pool. Random
+     * access ranges, and where stages over them, are split into slices
+     * summed in parallel, with any predicate called concurrently; small
+     * ranges and other inputs are summed serially.
+     */
+    parallel_summer_tag<Mode> parallel() const noexcept
+    {
+        return parallel_summer_tag<Mode>{thread_pool::shared()};
+    }
+
+    parallel_summer_tag<Mode> parallel(thread_pool& pool) const noexcept
+    {
+        return parallel_summer_tag<Mode>{pool};
+    }
+
+    /**
+     * Sum of an append-only container that only adds up new elements when
+     * called again; see incremental_sum.
+     */
+    incremental_summer_tag<Mode> incremental() const noexcept
+    {
+        return {};
+    }
+};
+
+using summer_tag = basic_summer_tag<>;
+
+/**
+ * Sum of the elements. sum<precise>() compensates floating point rounding
+ * errors, with vector kernels on contiguous ranges and where stages over
+ * them; this relies on strict IEEE arithmetic, which -ffast-math breaks.
+ * sum<Acc>() for an arithmetic type Acc adds the elements up in Acc, so
+ * that narrow integer columns can be summed without overflowing; those of
+ * 8 and 16 bits are summed exactly by widening vector kernels.
+ */
+template <typename Mode = void>
 constexpr
-summer_tag sum() noexcept
+basic_summer_tag<Mode> sum() noexcept
 {
     return {};
 }
 
-template <typename Enumerable>
-auto operator%(const Enumerable& range, const sum_tag&)
+template <typename Enumerable, typename Mode>
+auto operator%(const Enumerable& range, const basic_sum_tag<Mode>&)
 {
-    return detail::sum_range(std::cbegin(range), std::cend(range));
+    return detail::summation<Mode>::range(std::cbegin(range), std::cend(range));
 }
 
-template <typename Enumerable>
-auto operator%(const Enumerable& range, const summer_tag&)
+template <typename Enumerable, typename Mode>
+auto operator%(const Enumerable& range, const basic_summer_tag<Mode>&)
 {
     return [begin = std::cbegin(range),
             end = std::cend(range)]
     {
-        return detail::sum_range(begin, end);
+        return detail::summation<Mode>::range(begin, end);
+    };
+}
+
+template <typename Container, typename Mode,
+          typename = std::enable_if_t<detail::is_appendable<Container>::value>>
+incremental_sum<Container, Mode> operator%(const Container& container,
+                                           const incremental_summer_tag<Mode>&) noexcept
+{
+    return incremental_sum<Container, Mode>{container};
+}
+
+// The handle would outlive a temporary container.
+template <typename Container, typename Mode>
+void operator%(const Container&&, const incremental_summer_tag<Mode>&) = delete;
+
+template <typename Enumerable, typename Mode>
+auto operator%(const Enumerable& range, const parallel_sum_tag<Mode>& tag)
+{
+    return detail::parallel_sum_range<Mode>(std::cbegin(range),
+                                            std::cend(range), tag.pool());
+}
+
+template <typename Enumerable, typename Mode>
+auto operator%(const Enumerable& range, const parallel_summer_tag<Mode>& summer)
+{
+    return [begin = std::cbegin(range),
+            end = std::cend(range),
+            tag = summer()]
+    {
+        return detail::parallel_sum_range<Mode>(begin, end, tag.pool());
     };
 }
 
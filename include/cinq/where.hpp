@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include <iterator>
+#include <type_traits>
+#include <cinq/box.hpp>
 #include <cinq/enumerable.hpp>
 
 namespace cinq
@@ -30,14 +32,15 @@ public:
 
 public:
     where_iterator(iterator_type base, iterator_type end, Predicate pred)
-        : _it{ std::move(base) },
+        : _begin{ base },
+          _it{ std::find_if(std::move(base), end, pred) },
           _end{ std::move(end) },
           _pred{ std::move(pred) }
     {}
 
     where_iterator& operator++()
     {
-        _it = std::find_if(++_it, _end, _pred);
+        _it = std::find_if(++_it, _end, _pred.get());
         return *this;
     }
 
@@ -51,6 +54,14 @@ public:
     reference operator*()  const { return _it.operator*(); }
     pointer   operator->() const { return _it.operator->(); }
 
+    // The wrapped range and predicate, for operators that rewrite pipelines.
+    // base_begin() is where the wrapped range started, before elements that
+    // fail the predicate were skipped.
+    const iterator_type& base()       const noexcept { return _it; }
+    const iterator_type& base_begin() const noexcept { return _begin; }
+    const iterator_type& base_end()   const noexcept { return _end; }
+    const Predicate&     predicate()  const noexcept { return _pred.get(); }
+
     friend
     bool operator==(const where_iterator& lhs,
                     const where_iterator& rhs)
@@ -66,9 +77,10 @@ public:
     }
 
 private:
+    iterator_type _begin;
     iterator_type _it;
     iterator_type _end;
-    Predicate     _pred;
+    detail::box<Predicate> _pred;
 };
 
 template <typename Predicate>
@@ -80,7 +92,8 @@ struct where_closure
 template <typename Predicate>
 auto where(Predicate&& pred) noexcept
 {
-    return where_closure<Predicate>{ std::forward<Predicate>(pred) };
+    return where_closure<std::decay_t<Predicate>>{
+            std::forward<Predicate>(pred) };
 }
 
 template <typename Iterator, typename Predicate>
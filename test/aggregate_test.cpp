@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+TEST_CASE("Aggregate of a range", "[aggregate]")
+{
+    using namespace cinq;
+
+    std::vector<int> v;
+    for (int i = 0; i < 1000; ++i)
+        v.push_back(i * 37 % 1001 - 300);
+    std::list<int> l(v.begin(), v.end());
+
+    auto all = aggregate(sum(), min(), max(), count(), avg());
+    int total = 0, lo = v[0], hi = v[0];
+    for (int i : v)
+    {
+        total += i;
+        lo = std::min(lo, i);
+        hi = std::max(hi, i);
+    }
+    auto expected = std::make_tuple(total, lo, hi, std::size_t{1000},
+                                    total / 1000.0);
+
+    REQUIRE(v % all == expected);
+    REQUIRE(from(l) % all == expected);
+
+    SECTION("Through where")
+    {
+        auto odd = [](int i) { return i % 2 != 0; };
+        auto fused = from(v) % where(odd) % all;
+        auto serial = from(l) % where(odd) % all;
+        REQUIRE(fused == serial);
+        REQUIRE(std::get<3>(fused) == 500);
+    }
+    SECTION("NaN")
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        auto extremes = aggregate(min(), max());
+        for (std::size_t at : {0, 1, 40, 299})
+        {
+            std::vector<double> d(300);
+            for (std::size_t i = 0; i < d.size(); ++i)
+                d[i] = static_cast<double>(i % 17);
+            d[at] = nan;
+            std::list<double> dl(d.begin(), d.end());
+
+            for (const auto& r : {d % extremes, from(dl) % extremes,
+                                  from(d) % where([](double) { return true; }) % extremes})
+            {
+                REQUIRE(std::isnan(std::get<0>(r)));
+                REQUIRE(std::isnan(std::get<1>(r)));
+            }
+        }
+        const double inf = std::numeric_limits<double>::infinity();
+        std::vector<double> infinities(100, 1.0);
+        infinities[10] = inf;
+        infinities[90] = -inf;
+        REQUIRE(infinities % extremes == std::make_tuple(-inf, inf));
+
+        std::vector<double> d = {nan, 1.0, 2.0};
+        auto skip_nan = [](double x) { return !std::isnan(x); };
+        REQUIRE(from(d) % where(skip_nan) % extremes == std::make_tuple(1.0, 2.0));
+    }
+    SECTION("Empty ranges")
+    {
+        std::vector<double> empty;
+        REQUIRE(std::get<0>(empty % aggregate(count(), sum())) == 0);
+        REQUIRE_THROWS_AS(empty % aggregate(min()), std::out_of_range);
+        REQUIRE_THROWS_AS(from(v) % where([](int i) { return i > 5000; }) %
+                          aggregate(avg()), std::out_of_range);
+    }
+}
+
+TEST_CASE("Summary kernels", "[aggregate]")
+{
+    using namespace cinq::detail;
+
+    std::vector<std::int8_t> bytes(300);
+    std::vector<float> floats(300);
+    for (int i = 0; i < 300; ++i)
+    {
+        bytes[i] = static_cast<std::int8_t>(i * 13);
+        floats[i] = static_cast<float>(i % 17) - 8.5f;
+    }
+    auto even = [](auto x) { return static_cast<int>(x) % 2 == 0; };
+
+    auto check = [&](const auto& v, std::size_t n, simd_isa isa)
+    {
+        using T = typename std::decay_t<decltype(v)>::value_type;
+        auto s = summarize(v.data(), n, even, isa);
+        range_summary<T> expected;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (!even(v[i]))
+                continue;
+            ++expected.count;
+            expected.sum += v[i];
+            expected.min = std::min(expected.min, v[i]);
+            expected.max = std::max(expected.max, v[i]);
+        }
+        REQUIRE(s.count == expected.count);
+        REQUIRE(s.sum == expected.sum);
+        REQUIRE(s.min == expected.min);
+        REQUIRE(s.max == expected.max);
+    };
+
+    for (auto isa : {simd_isa::sse2, simd_isa::avx2, simd_isa::avx512})
+    {
+        if (isa > simd_level())
+            continue;
+        for (std::size_t n : {0, 1, 31, 32, 33, 255, 300})
+        {
+            check(bytes, n, isa);
+            check(floats, n, isa);
+        }
+    }
+}
+
+TEST_CASE("Group by with min, max and avg", "[aggregate]")
+{
+    using namespace cinq;
+
+    struct reading
+    {
+        int sensor;
+        double value;
+    };
+    std::vector<reading> readings = {{1, 2.0}, {2, -1.0}, {1, 4.0}, {1, 0.0}};
+
+    auto groups = from(readings) % group_by(&reading::sensor) %
+                  aggregate(min(&reading::value), max(&reading::value),
+                            avg(&reading::value));
+
+    REQUIRE(groups.size() == 2);
+    REQUIRE(groups[0].second == std::make_tuple(0.0, 4.0, 2.0));
+    REQUIRE(groups[1].second == std::make_tuple(-1.0, -1.0, -1.0));
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <list>
+#include <utility>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    template <typename Enumerable>
+    std::vector<std::pair<int, int>> sorted_rows(const Enumerable& result)
+    {
+        std::vector<std::pair<int, int>> res;
+        for (const auto& row : result)
+            res.emplace_back(row.first, row.second.second);
+        std::sort(res.begin(), res.end());
+        return res;
+    }
+}
+
+TEST_CASE("Join picks its algorithm", "[auto_join]")
+{
+    using namespace cinq;
+
+    std::vector<int> v{1, 2, 2, 3, 5, 8, 8, 9, 11, 12};
+    std::vector<std::pair<int, int>> v2{{0, 0}, {2, 1}, {2, 2}, {5, 3},
+                                        {8, 4}, {9, 5}, {10, 6}, {12, 7},
+                                        {14, 8}, {15, 9}};
+    std::vector<std::pair<int, int>> small{{2, 1}, {8, 4}};
+    std::list<std::pair<int, int>> list(v2.begin(), v2.end());
+
+    auto key_a = [](int i) { return i; };
+    auto key_b = &std::pair<int, int>::first;
+    auto expected = sorted_rows(from(v) % join(v2).on_keys(key_a, key_b));
+    REQUIRE(expected.size() == 9);
+
+    auto joined = from(v) % join(v2).on(key_a, key_b);
+    REQUIRE(joined.begin().strategy() == join_hint::hash);
+    REQUIRE(sorted_rows(joined) == expected);
+
+    auto tiny = from(v) % join(small).on(key_a, key_b);
+    REQUIRE(tiny.begin().strategy() == join_hint::nested_loop);
+    REQUIRE(sorted_rows(tiny) == (std::vector<std::pair<int, int>>{
+            {2, 1}, {2, 1}, {8, 4}, {8, 4}}));
+
+    auto unknown = from(v) % join(list).on(key_a, key_b);
+    REQUIRE(unknown.begin().strategy() == join_hint::hash);
+    REQUIRE(sorted_rows(unknown) == expected);
+
+    auto sorted = from(v) % join(list).on(key_a, key_b).sorted();
+    REQUIRE(sorted.begin().strategy() == join_hint::merge);
+    REQUIRE(sorted_rows(sorted) == expected);
+
+    SECTION("Hint overrides the choice")
+    {
+        for (auto hint : {join_hint::nested_loop, join_hint::hash,
+                          join_hint::merge})
+        {
+            auto result = from(v) % join(v2).on(key_a, key_b).hint(hint);
+            REQUIRE(result.begin().strategy() == hint);
+            REQUIRE(sorted_rows(result) == expected);
+        }
+    }
+}
+
+namespace
+{
+    // A key that can only be compared for equality.
+    struct point
+    {
+        int x;
+        int y;
+
+        bool operator==(const point& rhs) const
+        {
+            return x == rhs.x && y == rhs.y;
+        }
+    };
+}
+
+TEST_CASE("Join falls back on keys that cannot be hashed", "[auto_join]")
+{
+    using namespace cinq;
+
+    std::vector<std::pair<int, int>> v{{1, 1}, {1, 2}, {2, 2}, {3, 1},
+                                       {3, 3}, {4, 0}, {4, 4}, {5, 5},
+                                       {6, 1}, {7, 7}};
+    std::vector<std::pair<std::pair<int, int>, int>> v2{
+            {{1, 2}, 0}, {{2, 2}, 1}, {{3, 3}, 2}, {{4, 4}, 3}, {{4, 4}, 4},
+            {{5, 0}, 5}, {{6, 1}, 6}, {{7, 7}, 7}, {{8, 8}, 8}, {{9, 9}, 9}};
+
+    auto rows = [](const auto& result)
+    {
+        std::vector<std::pair<int, int>> res;
+        for (const auto& row : result)
+            res.emplace_back(row.first.first * 10 + row.first.second,
+                             row.second.second);
+        std::sort(res.begin(), res.end());
+        return res;
+    };
+    const std::vector<std::pair<int, int>> expected{
+            {12, 0}, {22, 1}, {33, 2}, {44, 3}, {44, 4}, {61, 6}, {77, 7}};
+
+    SECTION("Ordered keys merge or loop")
+    {
+        auto key_a = [](const std::pair<int, int>& p) { return p; };
+        auto key_b = &std::pair<std::pair<int, int>, int>::first;
+
+        auto joined = from(v) % join(v2).on(key_a, key_b);
+        REQUIRE(joined.begin().strategy() == join_hint::nested_loop);
+        REQUIRE(rows(joined) == expected);
+
+        auto hinted = from(v) % join(v2).on(key_a, key_b)
+                                        .hint(join_hint::hash);
+        REQUIRE(hinted.begin().strategy() == join_hint::nested_loop);
+        REQUIRE(rows(hinted) == expected);
+
+        auto sorted = from(v) % join(v2).on(key_a, key_b).sorted();
+        REQUIRE(sorted.begin().strategy() == join_hint::merge);
+        REQUIRE(rows(sorted) == expected);
+    }
+
+    SECTION("Equality-only keys loop")
+    {
+        auto key_a = [](const std::pair<int, int>& p)
+        {
+            return point{p.first, p.second};
+        };
+        auto key_b = [](const std::pair<std::pair<int, int>, int>& p)
+        {
+            return point{p.first.first, p.first.second};
+        };
+
+        for (auto hint : {join_hint::automatic, join_hint::nested_loop,
+                          join_hint::hash, join_hint::merge})
+        {
+            auto result = from(v) % join(v2).on(key_a, key_b).hint(hint);
+            REQUIRE(result.begin().strategy() == join_hint::nested_loop);
+            REQUIRE(rows(result) == expected);
+        }
+        auto sorted = from(v) % join(v2).on(key_a, key_b).sorted();
+        REQUIRE(sorted.begin().strategy() == join_hint::nested_loop);
+        REQUIRE(rows(sorted) == expected);
+    }
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    struct event
+    {
+        int ts;
+        int id;
+    };
+
+    struct range_row
+    {
+        int lo;
+        int hi;
+        int id;
+    };
+
+    template <typename Enumerable>
+    std::vector<std::pair<int, int>> ids(const Enumerable& result)
+    {
+        std::vector<std::pair<int, int>> res;
+        for (const auto& row : result)
+            res.emplace_back(row.first.id, row.second.id);
+        std::sort(res.begin(), res.end());
+        return res;
+    }
+}
+
+TEST_CASE("Band join", "[band_join]")
+{
+    using namespace cinq;
+
+    std::mt19937 rng{7};
+    std::vector<event> a(300), b(200);
+    for (int i = 0; i < 300; ++i)
+        a[i] = {static_cast<int>(rng() % 1000), i};
+    for (int i = 0; i < 200; ++i)
+        b[i] = {static_cast<int>(rng() % 1000), i};
+
+    auto expected = ids(from(a) % join(b).on([](const event& x, const event& y)
+                                             { return std::abs(x.ts - y.ts) < 5; }));
+    auto result = from(a) % join(b).on_band(&event::ts, &event::ts, 5);
+
+    REQUIRE(!expected.empty());
+    REQUIRE(ids(result) == expected);
+
+    SECTION("Unsigned keys")
+    {
+        std::vector<unsigned> u = {0, 1, 10};
+        std::vector<unsigned> w = {0, 2, 12};
+        auto self = [](unsigned x) { return x; };
+        auto res = from(u) % join(w).on_band(self, self, 3u);
+        REQUIRE(std::distance(res.begin(), res.end()) == 5);
+    }
+}
+
+TEST_CASE("Interval join", "[band_join]")
+{
+    using namespace cinq;
+
+    std::mt19937 rng{11};
+    std::vector<event> a(300);
+    std::vector<range_row> b(100);
+    for (int i = 0; i < 300; ++i)
+        a[i] = {static_cast<int>(rng() % 1000), i};
+    for (int i = 0; i < 100; ++i)
+    {
+        int lo = static_cast<int>(rng() % 1000);
+        b[i] = {lo, lo + static_cast<int>(rng() % 50), i};
+    }
+
+    auto expected = ids(from(a) % join(b).on([](const event& x, const range_row& r)
+                                             { return r.lo <= x.ts && x.ts < r.hi; }));
+    auto result = from(a) % join(b).on_interval(&event::ts, &range_row::lo,
+                                                &range_row::hi);
+
+    REQUIRE(!expected.empty());
+    REQUIRE(ids(result) == expected);
+}
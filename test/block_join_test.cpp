@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    template <typename Enumerable>
+    std::vector<std::pair<int, int>> sorted_rows(const Enumerable& result)
+    {
+        std::vector<std::pair<int, int>> res;
+        for (const auto& row : result)
+            res.emplace_back(row.first, row.second.second);
+        std::sort(res.begin(), res.end());
+        return res;
+    }
+}
+
+TEST_CASE("Block nested loop join", "[block_join]")
+{
+    using namespace cinq;
+
+    std::vector<int> v;
+    for (int i = 0; i < 700; ++i)
+        v.push_back(i * 37 % 3000);
+    std::vector<std::pair<int, int>> v2;
+    for (int i = 0; i < 2500; ++i)
+        v2.emplace_back(i * 53 % 3000, i);
+
+    auto pred = [](int a, const std::pair<int, int>& b)
+    {
+        return a < b.first && b.first < a + 10;
+    };
+    auto expected = sorted_rows(from(v) % join(v2).on(pred));
+    REQUIRE(expected.size() > 1000);
+
+    auto blocked = from(v) % join(v2).on(pred).blocked();
+    REQUIRE(sorted_rows(blocked) == expected);
+
+    SECTION("Comparison on keys")
+    {
+        auto key_a = [](int a) { return a / 100; };
+        auto key_b = &std::pair<int, int>::first;
+        auto less = [](int a, const std::pair<int, int>& b)
+        {
+            return a / 100 < b.first;
+        };
+        auto compared = from(v) % join(v2).on_compare(key_a, std::less<>{}, key_b);
+        REQUIRE(sorted_rows(compared) == sorted_rows(from(v) % join(v2).on(less)));
+    }
+    SECTION("Empty inputs")
+    {
+        std::vector<int> none;
+        auto left = from(none) % join(v2).on(pred).blocked();
+        REQUIRE(left.begin() == left.end());
+        std::vector<std::pair<int, int>> none2;
+        auto right = from(v) % join(none2).on(pred).blocked();
+        REQUIRE(right.begin() == right.end());
+    }
+}
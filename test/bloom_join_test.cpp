@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    template <typename Enumerable>
+    std::vector<std::pair<int, int>> rows(const Enumerable& result)
+    {
+        std::vector<std::pair<int, int>> res;
+        for (const auto& row : result)
+            res.emplace_back(row.first, row.second.second);
+        return res;
+    }
+}
+
+TEST_CASE("Hash join with Bloom filter pushdown", "[bloom_join]")
+{
+    using namespace cinq;
+
+    std::vector<int> v(10000);
+    for (int i = 0; i < 10000; ++i)
+        v[i] = i + 1;
+    std::vector<std::pair<int, int>> v2;
+    for (int i = 0; i < 100; ++i)
+        v2.emplace_back(i * 97, i);
+
+    auto key_a = [](int i) { return i; };
+    auto key_b = &std::pair<int, int>::first;
+
+    std::size_t predicate_calls = 0;
+    auto odd = [&predicate_calls](int i)
+    {
+        ++predicate_calls;
+        return i % 2 == 1;
+    };
+
+    auto expected = rows(from(v) % where(odd) %
+                         join(v2).on_keys(key_a, key_b));
+    REQUIRE(predicate_calls == v.size());
+    REQUIRE(expected.size() == 50);
+
+    auto filtered = from(v) % where(odd);
+    predicate_calls = 0;
+    join_statistics stats;
+    auto result = filtered % join(v2).on_keys(key_a, key_b).bloom(&stats);
+    REQUIRE(rows(result) == expected);
+
+    SECTION("Filter runs below the where stage")
+    {
+        REQUIRE(stats.build_rows == v2.size());
+        REQUIRE(stats.bloom_checks == v.size());
+        REQUIRE(predicate_calls == stats.bloom_checks - stats.bloom_rejects);
+        REQUIRE(stats.filter_rate() > 0.95);
+    }
+    SECTION("Filter sees the elements the where stage skipped first")
+    {
+        auto even = [&predicate_calls](int i)
+        {
+            ++predicate_calls;
+            return i % 2 == 0;
+        };
+        auto evens = from(v) % where(even);
+        predicate_calls = 0;
+        join_statistics even_stats;
+        auto even_result = evens % join(v2).on_keys(key_a, key_b).bloom(&even_stats);
+        REQUIRE(rows(even_result).size() == 49);
+        REQUIRE(even_stats.bloom_checks == v.size());
+        REQUIRE(predicate_calls ==
+                even_stats.bloom_checks - even_stats.bloom_rejects);
+    }
+    SECTION("Counters follow the work done")
+    {
+        join_statistics lazy_stats;
+        auto lazy = from(v) % join(v2).on_keys(key_a, key_b).bloom(&lazy_stats);
+        // The table is built and the first row found up front.
+        REQUIRE(lazy_stats.build_rows == v2.size());
+        const auto seek_checks = lazy_stats.bloom_checks;
+        REQUIRE(seek_checks > 0);
+        REQUIRE(seek_checks < v.size());
+
+        auto it = lazy.begin();
+        ++it;
+        REQUIRE(lazy_stats.bloom_checks > seek_checks);
+        REQUIRE(lazy_stats.bloom_checks < v.size());
+    }
+    SECTION("Plain source without statistics")
+    {
+        auto plain = from(v) % join(v2).on_keys(key_a, key_b).bloom();
+        REQUIRE(std::distance(plain.begin(), plain.end()) == 99);
+    }
+}
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <list>
+#include <utility>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    template <typename Enumerable>
+    std::vector<std::pair<int, int>> sorted_rows(const Enumerable& result)
+    {
+        std::vector<std::pair<int, int>> res;
+        for (const auto& row : result)
+            res.emplace_back(row.first, row.second.second);
+        std::sort(res.begin(), res.end());
+        return res;
+    }
+}
+
+TEST_CASE("Grace join spills partitions beyond the memory limit", "[grace_join]")
+{
+    using namespace cinq;
+
+    std::vector<int> v;
+    for (int i = 0; i < 20000; ++i)
+        v.push_back(i % 7000);
+    std::vector<std::pair<int, int>> v2;
+    for (int i = 0; i < 10000; ++i)
+        v2.emplace_back(i * 3 % 9000, i);
+
+    auto key_a = [](int i) { return i; };
+    auto key_b = &std::pair<int, int>::first;
+
+    auto expected = sorted_rows(from(v) % join(v2).on_keys(key_a, key_b));
+    REQUIRE(!expected.empty());
+
+    SECTION("Spilled")
+    {
+        auto result = from(v) % join(v2).on_keys(key_a, key_b).grace(4096);
+        REQUIRE(sorted_rows(result) == expected);
+    }
+    SECTION("Spilled from a list")
+    {
+        std::list<std::pair<int, int>> l2(v2.begin(), v2.end());
+        auto result = from(v) % join(l2).on_keys(key_a, key_b).grace(4096);
+        REQUIRE(sorted_rows(result) == expected);
+    }
+    SECTION("Within the limit")
+    {
+        auto result = from(v) % join(v2).on_keys(key_a, key_b)
+                                         .grace(16 * 1024 * 1024);
+        REQUIRE(sorted_rows(result) == expected);
+    }
+}
+
+TEST_CASE("Grace join splits partitions beyond the memory limit", "[grace_join]")
+{
+    using namespace cinq;
+
+    auto key_a = [](int i) { return i; };
+    auto key_b = &std::pair<int, int>::first;
+
+    SECTION("Spread keys")
+    {
+        // Some 6 right rows fit 256 bytes, so 256 partitions do not suffice.
+        std::vector<int> v;
+        for (int i = 0; i < 20000; ++i)
+            v.push_back(i % 12000);
+        std::vector<std::pair<int, int>> v2;
+        for (int i = 0; i < 10000; ++i)
+            v2.emplace_back(i * 7 % 11000, i);
+
+        auto expected = sorted_rows(from(v) % join(v2).on_keys(key_a, key_b));
+        REQUIRE(expected.size() > 10000);
+        auto result = from(v) % join(v2).on_keys(key_a, key_b).grace(256);
+        REQUIRE(sorted_rows(result) == expected);
+    }
+    SECTION("A single key")
+    {
+        std::vector<int> v{1, 5, 5, 2};
+        std::vector<std::pair<int, int>> v2;
+        for (int i = 0; i < 1000; ++i)
+            v2.emplace_back(5, i);
+        v2.emplace_back(1, -1);
+
+        auto expected = sorted_rows(from(v) % join(v2).on_keys(key_a, key_b));
+        REQUIRE(expected.size() == 2001);
+        auto result = from(v) % join(v2).on_keys(key_a, key_b).grace(256);
+        REQUIRE(sorted_rows(result) == expected);
+    }
+}
+
+TEST_CASE("Grace join of empty inputs", "[grace_join]")
+{
+    using namespace cinq;
+
+    std::vector<int> v{1, 2, 3};
+    std::vector<int> empty;
+    auto id = [](int i) { return i; };
+
+    auto left = from(empty) % join(v).on_keys(id, id).grace(64);
+    REQUIRE(left.begin() == left.end());
+    auto right = from(v) % join(empty).on_keys(id, id).grace(64);
+    REQUIRE(right.begin() == right.end());
+}
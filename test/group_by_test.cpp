@@ -0,0 +1,126 @@
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    struct order
+    {
+        int customer;
+        double amount;
+        std::uint8_t items;
+    };
+
+    struct customer
+    {
+        int id;
+        std::string region;
+    };
+}
+
+TEST_CASE("Group by with sum and count", "[group_by]")
+{
+    using namespace cinq;
+
+    std::vector<order> orders = {
+            {3, 10.0, 1}, {1, 2.5, 200}, {3, 5.0, 200}, {2, 1.0, 1}, {1, 0.5, 100}};
+
+    auto groups = from(orders) % group_by(&order::customer) %
+                  aggregate(sum(&order::amount), count(),
+                            sum<std::int64_t>(&order::items));
+
+    using row = std::pair<int, std::tuple<double, std::size_t, std::int64_t>>;
+    REQUIRE(groups == std::vector<row>{
+            {3, std::make_tuple(15.0, std::size_t{2}, std::int64_t{201})},
+            {1, std::make_tuple(3.0, std::size_t{2}, std::int64_t{300})},
+            {2, std::make_tuple(1.0, std::size_t{1}, std::int64_t{1})}});
+
+    std::vector<int> empty;
+    REQUIRE((empty % group_by([](int i) { return i; }) % aggregate(count())).empty());
+}
+
+TEST_CASE("Group by over where and join", "[group_by]")
+{
+    using namespace cinq;
+
+    std::vector<int> v;
+    for (int i = 0; i < 10000; ++i)
+        v.push_back(i);
+
+    SECTION("Where")
+    {
+        auto groups = from(v) % where([](int i) { return i % 2 == 0; }) %
+                      group_by([](int i) { return i % 7; }) %
+                      aggregate(sum(), count());
+        REQUIRE(groups.size() == 7);
+        for (const auto& g : groups)
+        {
+            int sum = 0;
+            std::size_t count = 0;
+            for (int i : v)
+            {
+                if (i % 2 == 0 && i % 7 == g.first)
+                {
+                    sum += i;
+                    ++count;
+                }
+            }
+            REQUIRE(std::get<0>(g.second) == sum);
+            REQUIRE(std::get<1>(g.second) == count);
+        }
+    }
+    SECTION("Join")
+    {
+        std::vector<customer> customers = {{1, "north"}, {2, "south"}, {3, "north"}};
+        std::vector<order> orders = {{3, 10.0, 1}, {1, 2.5, 2}, {2, 1.0, 3}, {4, 9.0, 4}};
+
+        auto groups = from(orders) %
+                      join(customers).on_keys(&order::customer, &customer::id) %
+                      group_by([](const auto& row) { return row.second.region; }) %
+                      aggregate(sum([](const auto& row) { return row.first.amount; }),
+                                count());
+
+        using row = std::pair<std::string, std::tuple<double, std::size_t>>;
+        REQUIRE(groups == std::vector<row>{
+                {"north", std::make_tuple(12.5, std::size_t{2})},
+                {"south", std::make_tuple(1.0, std::size_t{1})}});
+    }
+}
+
+TEST_CASE("Group by with many groups", "[group_by]")
+{
+    using namespace cinq;
+
+    // Enough distinct keys for the table to grow several times over.
+    std::vector<int> v;
+    for (int i = 0; i < 20000; ++i)
+        v.push_back(i * 7919 % 5003);
+
+    auto key = [](int i) { return i % 3001 * 3; };
+    auto groups = from(v) % group_by(key) % aggregate(sum(), count());
+
+    std::vector<int> order;
+    std::map<int, std::pair<int, std::size_t>> expected;
+    for (int i : v)
+    {
+        auto inserted = expected.emplace(key(i), std::make_pair(0, std::size_t{0}));
+        if (inserted.second)
+            order.push_back(key(i));
+        inserted.first->second.first += i;
+        ++inserted.first->second.second;
+    }
+    REQUIRE(order.size() == 3001);
+
+    REQUIRE(groups.size() == order.size());
+    for (std::size_t i = 0; i < groups.size(); ++i)
+    {
+        REQUIRE(groups[i].first == order[i]);
+        REQUIRE(std::get<0>(groups[i].second) == expected[order[i]].first);
+        REQUIRE(std::get<1>(groups[i].second) == expected[order[i]].second);
+    }
+}
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    struct product
+    {
+        int id;
+        std::string name;
+    };
+}
+
+TEST_CASE("Join against a prebuilt hash index", "[hash_index]")
+{
+    using namespace cinq;
+
+    std::vector<product> products = {
+            {1, "apple"}, {2, "pear"}, {3, "plum"}, {2, "pear2"}};
+    auto by_id = index(products, &product::id);
+    REQUIRE(by_id.size() == 4);
+
+    auto names = [&](const std::vector<int>& batch)
+    {
+        std::vector<std::string> res;
+        for (const auto& row : from(batch) %
+                               join(by_id).on_key([](int i) { return i; }))
+            res.push_back(row.second.name);
+        std::sort(res.begin(), res.end());
+        return res;
+    };
+
+    REQUIRE(names({1, 3, 7}) == std::vector<std::string>{"apple", "plum"});
+    REQUIRE(names({2}) == std::vector<std::string>{"pear", "pear2"});
+    REQUIRE(names({}).empty());
+
+    SECTION("Concurrent probes")
+    {
+        std::vector<int> batch(1000);
+        for (int i = 0; i < 1000; ++i)
+            batch[i] = i % 4;
+
+        std::vector<std::size_t> counts(4);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < counts.size(); ++t)
+        {
+            threads.emplace_back([&, t]
+            {
+                auto result = from(batch) %
+                              join(by_id).on_key([](int i) { return i; });
+                counts[t] = static_cast<std::size_t>(
+                        std::distance(result.begin(), result.end()));
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        REQUIRE(std::all_of(counts.begin(), counts.end(),
+                            [](std::size_t c) { return c == 1000; }));
+    }
+}
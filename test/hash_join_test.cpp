@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <list>
+#include <string>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    struct order
+    {
+        int id;
+        int customer;
+    };
+
+    struct customer
+    {
+        int id;
+        std::string name;
+    };
+}
+
+TEST_CASE("Hash join on key extractors", "[hash_join]")
+{
+    using namespace cinq;
+
+    std::vector<int> v = {0, 1, 2, 3, 4};
+
+    std::vector<std::pair<int, std::string>> v2 = {
+            {0, "zero"}, {2, "two"}, {3, "three"}, {5, "five"}};
+
+    auto result = from(v) %
+                  join(v2).on_keys([](int i) { return i; },
+                                   [](const auto& j) { return j.first; });
+
+    std::list<std::pair<int, std::pair<int, std::string>>> res(
+            result.begin(), result.end());
+
+    std::list<std::pair<int, std::pair<int, std::string>>> exp{
+        {0, {0, "zero"}}, {2, {2, "two"}}, {3, {3, "three"}}};
+
+    REQUIRE(res == exp);
+}
+
+TEST_CASE("Hash join with duplicate keys", "[hash_join]")
+{
+    using namespace cinq;
+
+    std::vector<order> orders = {
+            {1, 10}, {2, 20}, {3, 10}, {4, 30}, {5, 40}, {6, 10}};
+    std::vector<customer> customers = {
+            {10, "ann"}, {20, "bob"}, {10, "ann2"}, {40, "dan"}};
+
+    auto to_rows = [](const auto& result)
+    {
+        std::vector<std::pair<int, std::string>> rows;
+        for (const auto& row : result)
+            rows.emplace_back(row.first.id, row.second.name);
+        std::sort(rows.begin(), rows.end());
+        return rows;
+    };
+
+    std::vector<std::pair<int, std::string>> exp = {
+            {1, "ann"}, {1, "ann2"}, {2, "bob"}, {3, "ann"}, {3, "ann2"},
+            {5, "dan"}, {6, "ann"}, {6, "ann2"}};
+
+    SECTION("Build on the joined range")
+    {
+        auto result = from(orders) %
+                      join(customers).on_keys(&order::customer, &customer::id);
+        REQUIRE(to_rows(result) == exp);
+    }
+    SECTION("Build on the smaller left range")
+    {
+        orders.resize(2);
+        auto result = from(orders) %
+                      join(customers).on_keys(&order::customer, &customer::id);
+        REQUIRE(to_rows(result) ==
+                std::vector<std::pair<int, std::string>>{
+                        {1, "ann"}, {1, "ann2"}, {2, "bob"}});
+    }
+    SECTION("Forward-only filtered input")
+    {
+        std::list<customer> list(customers.begin(), customers.end());
+        auto result = from(orders) %
+                      join(from(list) % where([](const customer& c)
+                                              { return c.id != 20; }))
+                          .on_keys(&order::customer, &customer::id);
+        exp.erase(std::remove(exp.begin(), exp.end(),
+                              std::make_pair(2, std::string{"bob"})),
+                  exp.end());
+        REQUIRE(to_rows(result) == exp);
+    }
+    SECTION("Empty inputs")
+    {
+        std::vector<customer> none;
+        auto result = from(orders) %
+                      join(none).on_keys(&order::customer, &customer::id);
+        REQUIRE(result.begin() == result.end());
+    }
+}
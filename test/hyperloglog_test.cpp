@@ -0,0 +1,100 @@
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+TEST_CASE("Approximate distinct count", "[hyperloglog]")
+{
+    using namespace cinq;
+
+    // 100000 distinct values, each repeated.
+    std::vector<std::uint64_t> events;
+    for (std::uint64_t i = 0; i < 300000; ++i)
+        events.push_back(i % 100000 * 7919);
+
+    const auto estimate = events % count_distinct_approx([](std::uint64_t e) { return e; });
+    REQUIRE(std::abs(static_cast<double>(estimate) - 100000) < 3000);
+
+    // Small sets are counted almost exactly.
+    std::vector<std::string> names = {"a", "b", "c", "a", "b", "d"};
+    REQUIRE(from(names) % count_distinct_approx([](const std::string& s) { return s; }, 10) == 4);
+
+    std::vector<int> none;
+    REQUIRE(none % count_distinct_approx([](int i) { return i; }) == 0);
+
+    REQUIRE_THROWS_AS(hyperloglog{3}, std::invalid_argument);
+    REQUIRE_THROWS_AS(hyperloglog{19}, std::invalid_argument);
+}
+
+TEST_CASE("Merging and serializing sketches", "[hyperloglog]")
+{
+    using namespace cinq;
+
+    std::vector<int> v;
+    for (int i = 0; i < 50000; ++i)
+        v.push_back(i);
+    auto id = [](int i) { return i; };
+
+    auto whole = v % distinct_sketch(id, 12);
+    auto low = from(v) % where([](int i) { return i < 20000; }) % distinct_sketch(id, 12);
+    auto high = from(v) % where([](int i) { return i >= 15000; }) % distinct_sketch(id, 12);
+    REQUIRE(low != whole);
+    low.merge(high);
+    REQUIRE(low == whole);
+    REQUIRE_THROWS_AS(low.merge(hyperloglog{13}), std::invalid_argument);
+
+    auto bytes = whole.serialize();
+    REQUIRE(bytes.size() == 2 + 4096);
+    REQUIRE(hyperloglog::deserialize(bytes) == whole);
+    REQUIRE(hyperloglog::deserialize(bytes).estimate() == whole.estimate());
+
+    bytes.pop_back();
+    REQUIRE_THROWS_AS(hyperloglog::deserialize(bytes), std::invalid_argument);
+    bytes.push_back(60);
+    REQUIRE_THROWS_AS(hyperloglog::deserialize(bytes), std::invalid_argument);
+
+    SECTION("Fixed hashes")
+    {
+        // Pinned, as serialized sketches depend on them.
+        REQUIRE(detail::sketch_hash(1) == 0xb456bcfc34c2cb2cULL);
+        REQUIRE(detail::sketch_hash(std::string{"cinq"}) == 0xf9ec23d0b7ebe002ULL);
+        REQUIRE(detail::sketch_hash(std::uint8_t{1}) == detail::sketch_hash(1LL));
+        REQUIRE(detail::sketch_hash(1.5f) == detail::sketch_hash(1.5));
+        REQUIRE(detail::sketch_hash(-0.0) == detail::sketch_hash(0.0));
+        REQUIRE(detail::sketch_hash("cinq") == detail::sketch_hash(std::string{"cinq"}));
+        char name1[] = "cinq";
+        char name2[] = "cinq";
+        REQUIRE(detail::sketch_hash(static_cast<char*>(name1)) == detail::sketch_hash("cinq"));
+        std::vector<char*> names = {name1, name2};
+        REQUIRE(names % count_distinct_approx([](char* s) { return s; }, 10) == 1);
+
+        auto unknown = whole.serialize();
+        unknown[0] = 2;
+        REQUIRE_THROWS_AS(hyperloglog::deserialize(unknown), std::invalid_argument);
+    }
+    SECTION("Register merge kernels")
+    {
+        std::vector<std::uint8_t> a(1000), b(1000);
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            a[i] = static_cast<std::uint8_t>(i * 7 % 51);
+            b[i] = static_cast<std::uint8_t>(i * 13 % 47);
+        }
+        for (auto isa : {detail::simd_isa::sse2, detail::simd_isa::avx2,
+                         detail::simd_isa::avx512})
+        {
+            if (isa > detail::simd_level())
+                continue;
+            for (std::size_t n : {0, 15, 64, 1000})
+            {
+                auto merged = a;
+                detail::max_registers(merged.data(), b.data(), n, isa);
+                for (std::size_t i = 0; i < a.size(); ++i)
+                    REQUIRE(merged[i] == (i < n ? std::max(a[i], b[i]) : a[i]));
+            }
+        }
+    }
+}
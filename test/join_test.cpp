@@ -25,4 +25,19 @@ TEST_CASE("Join test", "[join]")
     REQUIRE(res == exp);
 }
 
+TEST_CASE("Join skips non-matching pairs", "[join]")
+{
+    using namespace cinq;
+
+    std::vector<int> v = {1, 2, 3};
+    std::vector<int> v2 = {2, 3, 9};
 
+    auto result = from(v) % join(v2).on([](int i, int j) { return i == j; });
+
+    std::list<std::pair<int, int>> res(result.begin(), result.end());
+    REQUIRE(res == std::list<std::pair<int, int>>{{2, 2}, {3, 3}});
+
+    std::vector<int> none;
+    auto empty = from(v) % join(none).on([](int, int) { return true; });
+    REQUIRE(empty.begin() == empty.end());
+}
@@ -0,0 +1,80 @@
+#include <array>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    struct edge
+    {
+        int from;
+        int to;
+    };
+}
+
+TEST_CASE("Leapfrog join finds triangles", "[leapfrog_join]")
+{
+    using namespace cinq;
+
+    std::vector<edge> edges;
+    for (int a = 0; a < 40; ++a)
+    {
+        for (int b = a + 1; b < 40; ++b)
+        {
+            if ((a * 7 + b * 3) % 5 < 2)
+                edges.push_back({a, b});
+        }
+    }
+
+    std::set<std::array<int, 3>> expected;
+    for (const auto& ab : edges)
+        for (const auto& bc : edges)
+            for (const auto& ac : edges)
+                if (ab.to == bc.from && ab.from == ac.from && bc.to == ac.to)
+                    expected.insert({ab.from, ab.to, bc.to});
+    REQUIRE(!expected.empty());
+
+    auto triangles = leapfrog_join<3>(atom(edges, &edge::from, &edge::to, 0, 1),
+                                      atom(edges, &edge::from, &edge::to, 1, 2),
+                                      atom(edges, &edge::from, &edge::to, 0, 2));
+    std::vector<std::array<int, 3>> result(triangles.begin(), triangles.end());
+    REQUIRE(result == std::vector<std::array<int, 3>>(expected.begin(),
+                                                      expected.end()));
+
+    SECTION("Variables may appear in either order")
+    {
+        auto reversed = leapfrog_join<3>(
+                atom(edges, &edge::to, &edge::from, 1, 0),
+                atom(edges, &edge::from, &edge::to, 1, 2),
+                atom(edges, &edge::to, &edge::from, 2, 0));
+        std::vector<std::array<int, 3>> rows(reversed.begin(), reversed.end());
+        REQUIRE(rows == result);
+    }
+}
+
+TEST_CASE("Leapfrog join of two relations", "[leapfrog_join]")
+{
+    using namespace cinq;
+
+    std::vector<std::pair<int, int>> r{{1, 10}, {2, 20}, {2, 21}, {3, 30},
+                                       {2, 20}};
+    std::vector<std::pair<int, int>> s{{20, 5}, {21, 6}, {30, 7}, {40, 8}};
+    auto first = &std::pair<int, int>::first;
+    auto second = &std::pair<int, int>::second;
+
+    auto paths = leapfrog_join<3>(atom(r, first, second, 0, 1),
+                                  atom(s, first, second, 1, 2));
+    std::vector<std::array<int, 3>> rows(paths.begin(), paths.end());
+    REQUIRE(rows == (std::vector<std::array<int, 3>>{
+            {2, 20, 5}, {2, 21, 6}, {3, 30, 7}}));
+
+    auto empty = leapfrog_join<2>(atom(r, first, second, 0, 1),
+                                  atom(s, first, first, 0, 1));
+    REQUIRE(empty.begin() == empty.end());
+
+    REQUIRE_THROWS_AS(leapfrog_join<3>(atom(r, first, second, 0, 1)),
+                      std::invalid_argument);
+}
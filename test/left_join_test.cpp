@@ -0,0 +1,37 @@
+#include <string>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+TEST_CASE("Left outer join on keys", "[left_join]")
+{
+    using namespace cinq;
+
+    std::vector<int> v = {0, 1, 2, 3, 4};
+
+    std::vector<std::pair<int, std::string>> v2 = {
+            {0, "zero"}, {2, "two"}, {3, "three"}, {2, "deux"}, {5, "five"}};
+
+    auto result = from(v) %
+                  left_join(v2).on_keys([](int i) { return i; },
+                                        &std::pair<int, std::string>::first);
+
+    std::vector<std::pair<int, std::string>> res;
+    for (const auto& row : result)
+        res.emplace_back(row.first, row.second ? row.second->second : "-");
+
+    std::vector<std::pair<int, std::string>> exp{
+        {0, "zero"}, {1, "-"}, {2, "two"}, {2, "deux"}, {3, "three"}, {4, "-"}};
+
+    REQUIRE(res == exp);
+
+    SECTION("Empty right input keeps every left element")
+    {
+        std::vector<std::pair<int, std::string>> none;
+        auto unmatched = from(v) %
+                         left_join(none).on_keys(
+                                 [](int i) { return i; },
+                                 &std::pair<int, std::string>::first);
+        REQUIRE(std::distance(unmatched.begin(), unmatched.end()) == 5);
+    }
+}
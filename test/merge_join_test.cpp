@@ -0,0 +1,60 @@
+#include <forward_list>
+#include <list>
+#include <string>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+TEST_CASE("Merge join on sorted inputs", "[merge_join]")
+{
+    using namespace cinq;
+
+    std::vector<int> v = {0, 1, 2, 3, 4};
+
+    std::vector<std::pair<int, std::string>> v2 = {
+            {0, "zero"}, {2, "two"}, {3, "three"}, {5, "five"}};
+
+    auto result = from(v) %
+                  join(v2).on_sorted([](int i) { return i; },
+                                     &std::pair<int, std::string>::first);
+
+    std::list<std::pair<int, std::pair<int, std::string>>> res(
+            result.begin(), result.end());
+
+    std::list<std::pair<int, std::pair<int, std::string>>> exp{
+        {0, {0, "zero"}}, {2, {2, "two"}}, {3, {3, "three"}}};
+
+    REQUIRE(res == exp);
+}
+
+TEST_CASE("Merge join with duplicate key runs", "[merge_join]")
+{
+    using namespace cinq;
+
+    using row = std::pair<int, char>;
+    auto key = &row::first;
+
+    std::vector<row> v = {{1, 'a'}, {2, 'b'}, {2, 'c'}, {4, 'd'}, {7, 'e'}};
+    std::forward_list<row> v2 = {
+            {0, 'v'}, {2, 'w'}, {2, 'x'}, {3, 'y'}, {7, 'z'}};
+
+    std::vector<std::pair<char, char>> res;
+    for (const auto& r : from(v) % join(v2).on_sorted(key, key))
+        res.emplace_back(r.first.second, r.second.second);
+
+    REQUIRE(res == std::vector<std::pair<char, char>>{
+            {'b', 'w'}, {'b', 'x'}, {'c', 'w'}, {'c', 'x'}, {'e', 'z'}});
+
+    SECTION("Right input exhausted first")
+    {
+        v.push_back({9, 'f'});
+        auto result = from(v) % join(v2).on_sorted(key, key);
+        REQUIRE(std::distance(result.begin(), result.end()) == 5);
+    }
+    SECTION("Empty input")
+    {
+        std::vector<row> none;
+        auto result = from(none) % join(v2).on_sorted(key, key);
+        REQUIRE(result.begin() == result.end());
+    }
+}
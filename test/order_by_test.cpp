@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    struct result
+    {
+        int id;
+        double score;
+    };
+
+    struct user
+    {
+        int id;
+        std::string name;
+    };
+}
+
+TEST_CASE("Order by and take", "[order_by]")
+{
+    using namespace cinq;
+
+    std::vector<result> results = {
+            {1, 0.5}, {2, 0.9}, {3, 0.1}, {4, 0.9}, {5, 0.7}, {6, 0.3}};
+    auto ids = [](const std::vector<result>& rs)
+    {
+        std::vector<int> v;
+        for (const auto& r : rs)
+            v.push_back(r.id);
+        return v;
+    };
+
+    // Equal scores keep their order in the range.
+    REQUIRE(ids(results % top_k(3, &result::score)) == std::vector<int>{2, 4, 5});
+    REQUIRE(ids(from(results) % order_by(&result::score) % take(2)) == std::vector<int>{3, 6});
+    REQUIRE(ids(results % order_by_descending(&result::score) % take(10)) ==
+            std::vector<int>{2, 4, 5, 1, 6, 3});
+    REQUIRE((results % top_k(0, &result::score)).empty());
+
+    // Counts beyond the range reserve no more than it holds.
+    std::vector<int> few = {3, 1, 2};
+    const auto all = static_cast<std::size_t>(-1);
+    REQUIRE((few % order_by() % take(all)) == std::vector<int>{1, 2, 3});
+    REQUIRE((from(few) % where([](int) { return true; }) % top_k(all)) ==
+            std::vector<int>{3, 2, 1});
+    REQUIRE(ids(results % top_k(all / 2 + 1, &result::score)).size() == results.size());
+
+    // Strings take the element by element path.
+    std::vector<std::string> names = {"eve", "bea", "dan"};
+    REQUIRE((names % order_by() % take(2)) == std::vector<std::string>{"bea", "dan"});
+
+    REQUIRE(ids(from(results) % where([](const result& r) { return r.id % 2 == 0; }) %
+                top_k(2, &result::score)) == std::vector<int>{2, 4});
+
+    std::vector<user> users = {{2, "bea"}, {4, "dan"}, {5, "eve"}};
+    auto joined = from(results) % join(users).on_keys(&result::id, &user::id) %
+                  top_k(2, [](const std::pair<const result&, const user&>& p)
+                  {
+                      return p.first.score;
+                  });
+    REQUIRE(joined.size() == 2);
+    REQUIRE(joined[0].second.name == "bea");
+    REQUIRE(joined[1].second.name == "dan");
+}
+
+TEST_CASE("Top k of many elements", "[order_by]")
+{
+    using namespace cinq;
+
+    std::mt19937 rng{5};
+    std::uniform_int_distribution<int> values{-1000000, 1000000};
+    std::vector<int> v(100000);
+    for (auto& x : v)
+        x = values(rng);
+    auto sorted = v;
+    std::sort(sorted.begin(), sorted.end());
+
+    // Contiguous elements ordered by themselves are skipped a vector at a
+    // time; a key function takes the element by element path.
+    auto largest = v % top_k(100);
+    REQUIRE(largest == std::vector<int>(sorted.rbegin(), sorted.rbegin() + 100));
+    REQUIRE((v % top_k(100, [](int x) { return x; })) == largest);
+    REQUIRE((v % order_by() % take(37)) == std::vector<int>(sorted.begin(), sorted.begin() + 37));
+    REQUIRE((v % order_by() % take(v.size() + 1)) == sorted);
+
+    SECTION("Skip kernels")
+    {
+        std::vector<double> d(1000, 1.0);
+        d[700] = 2.0;
+        for (auto isa : {detail::simd_isa::sse2, detail::simd_isa::avx2,
+                         detail::simd_isa::avx512})
+        {
+            if (isa > detail::simd_level())
+                continue;
+            const auto block = detail::skip_block<double>;
+            REQUIRE(detail::skip_worse<true>(d.data(), d.size(), 1.5, isa) == 700 / block * block);
+            REQUIRE(detail::skip_worse<false>(d.data(), d.size(), 1.0, isa) == d.size() / block * block);
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    template <typename Enumerable>
+    std::vector<std::pair<int, int>> rows(const Enumerable& result)
+    {
+        std::vector<std::pair<int, int>> res;
+        for (const auto& row : result)
+            res.emplace_back(row.first.second, row.second.second);
+        std::sort(res.begin(), res.end());
+        return res;
+    }
+}
+
+TEST_CASE("Thread pool runs every task once", "[parallel_join]")
+{
+    cinq::thread_pool pool{4};
+    REQUIRE(pool.size() == 4);
+
+    std::vector<std::atomic<int>> hits(1000);
+    for (int round = 0; round < 3; ++round)
+        pool.run(hits.size(), [&](std::size_t task, unsigned) { ++hits[task]; });
+    REQUIRE(std::all_of(hits.begin(), hits.end(),
+                        [](const std::atomic<int>& h) { return h == 3; }));
+
+    REQUIRE_THROWS_AS(pool.run(10, [](std::size_t task, unsigned)
+                      {
+                          if (task == 5)
+                              throw std::runtime_error{"task"};
+                      }),
+                      std::runtime_error);
+}
+
+TEST_CASE("Thread pool runs nested batches inline", "[parallel_join]")
+{
+    using namespace cinq;
+
+    thread_pool pool{4};
+    std::vector<std::atomic<int>> hits(100 * 50);
+    std::atomic<bool> other_worker{false};
+    pool.run(100, [&](std::size_t outer, unsigned)
+    {
+        pool.run(50, [&](std::size_t inner, unsigned worker)
+        {
+            other_worker = other_worker || worker != 0;
+            ++hits[outer * 50 + inner];
+        });
+    });
+    REQUIRE(!other_worker);
+    REQUIRE(std::all_of(hits.begin(), hits.end(),
+                        [](const std::atomic<int>& h) { return h == 1; }));
+
+    // Parallel sums on the shared pool, one in a predicate of the other.
+    std::vector<int> v(100000);
+    for (int i = 0; i < 100000; ++i)
+        v[i] = i % 1000;
+    std::vector<int> ones(70000, 1);
+    auto keep = [&](int i) { return i != 7 || ones % sum().parallel()() == 70000; };
+    REQUIRE(from(v) % where(keep) % sum().parallel()() == v % sum()());
+}
+
+TEST_CASE("Parallel hash join", "[parallel_join]")
+{
+    using namespace cinq;
+
+    using row = std::pair<int, int>;
+    auto key = &row::first;
+
+    std::vector<row> v;
+    for (int i = 0; i < 100000; ++i)
+        v.emplace_back(i % 30000, i);
+    std::vector<row> v2;
+    for (int i = 0; i < 20000; ++i)
+        v2.emplace_back(i * 7 % 40000, -i);
+
+    thread_pool pool{4};
+    auto expected = rows(from(v) % join(v2).on_keys(key, key));
+    REQUIRE(!expected.empty());
+
+    SECTION("Build on the joined range")
+    {
+        auto result = from(v) % join(v2).on_keys(key, key).parallel(pool);
+        REQUIRE(rows(result) == expected);
+    }
+    SECTION("Build on the left range")
+    {
+        auto result = from(v2) % join(v).on_keys(key, key).parallel(pool);
+        auto res = rows(result);
+        for (auto& r : res)
+            std::swap(r.first, r.second);
+        std::sort(res.begin(), res.end());
+        REQUIRE(res == expected);
+    }
+    SECTION("Shared pool and empty input")
+    {
+        std::vector<row> none;
+        auto result = from(v) % join(none).on_keys(key, key).parallel();
+        REQUIRE(result.begin() == result.end());
+    }
+}
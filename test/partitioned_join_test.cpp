@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    template <typename Enumerable>
+    std::vector<std::pair<int, int>> rows(const Enumerable& result)
+    {
+        std::vector<std::pair<int, int>> res;
+        for (const auto& row : result)
+            res.emplace_back(row.first.second, row.second.second);
+        std::sort(res.begin(), res.end());
+        return res;
+    }
+}
+
+TEST_CASE("Radix-partitioned hash join", "[partitioned_join]")
+{
+    using namespace cinq;
+
+    using row = std::pair<int, int>;
+    auto key = &row::first;
+
+    std::vector<row> v;
+    for (int i = 0; i < 5000; ++i)
+        v.emplace_back(i % 1500, i);
+    std::vector<row> v2;
+    for (int i = 0; i < 1200; ++i)
+        v2.emplace_back(i * 3 % 2000, -i);
+
+    auto expected = rows(from(v) % join(v2).on_keys(key, key));
+    REQUIRE(expected.size() > 1000);
+
+    SECTION("Explicit fan-out")
+    {
+        auto result = from(v) % join(v2).on_keys(key, key).partitioned(5);
+        REQUIRE(rows(result) == expected);
+    }
+    SECTION("Automatic fan-out")
+    {
+        auto result = from(v) % join(v2).on_keys(key, key).partitioned();
+        REQUIRE(rows(result) == expected);
+    }
+    SECTION("Build on the left")
+    {
+        auto result = from(v2) % join(v).on_keys(key, key).partitioned(3);
+        auto res = rows(result);
+        for (auto& r : res)
+            std::swap(r.first, r.second);
+        std::sort(res.begin(), res.end());
+        REQUIRE(res == expected);
+    }
+    SECTION("Empty input")
+    {
+        std::vector<row> none;
+        auto result = from(v) % join(none).on_keys(key, key).partitioned(4);
+        REQUIRE(result.begin() == result.end());
+    }
+}
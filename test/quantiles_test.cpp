@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    struct request
+    {
+        int id;
+        double latency;
+    };
+
+    // Fraction of the sorted values not greater than x.
+    double exact_rank(const std::vector<double>& sorted, double x)
+    {
+        return static_cast<double>(std::upper_bound(sorted.begin(), sorted.end(), x) -
+                                   sorted.begin()) / static_cast<double>(sorted.size());
+    }
+}
+
+TEST_CASE("Quantiles", "[quantiles]")
+{
+    using namespace cinq;
+
+    // Small ranges are retained whole, so their quantiles are exact.
+    std::vector<int> small = {5, 1, 4, 2, 3, 9, 8, 7, 6, 10};
+    REQUIRE(small % quantiles({0, 0.5, 0.9, 1}) == std::vector<int>{1, 5, 9, 10});
+    REQUIRE(from(small) % where([](int i) { return i % 2 == 0; }) % quantiles({0.5}) ==
+            std::vector<int>{6});
+
+    std::vector<request> requests = {{1, 0.25}, {2, 4.0}, {3, 1.5}};
+    REQUIRE(requests % quantiles(&request::latency, {0.5}) == std::vector<double>{1.5});
+
+    std::vector<double> none;
+    REQUIRE_THROWS_AS(none % quantiles({0.5}), std::out_of_range);
+    REQUIRE_THROWS_AS(small % quantiles({1.5}), std::invalid_argument);
+    REQUIRE_THROWS_AS(kll_sketch<int>{4}, std::invalid_argument);
+
+    // Long streams go through compactors and the sampler.
+    std::mt19937_64 rng{7};
+    std::lognormal_distribution<double> latency{0, 1};
+    for (std::size_t n : {std::size_t{100000}, std::size_t{3000000}})
+    {
+        std::vector<double> v(n);
+        for (auto& x : v)
+            x = latency(rng);
+        auto sketch = v % quantile_sketch([](double x) { return x; });
+        REQUIRE(sketch.count() == n);
+        REQUIRE(sketch.retained() < 1000);
+
+        std::vector<double> sorted(v);
+        std::sort(sorted.begin(), sorted.end());
+        const std::vector<double> ranks = {0.01, 0.1, 0.5, 0.9, 0.99, 0.999};
+        const auto estimates = sketch.quantiles(ranks);
+        for (std::size_t i = 0; i < ranks.size(); ++i)
+            REQUIRE(std::abs(exact_rank(sorted, estimates[i]) - ranks[i]) < 0.017);
+        REQUIRE(std::abs(sketch.rank(sorted[n / 4]) - 0.25) < 0.017);
+
+        // Value by value, as over iterators that cannot skip.
+        kll_sketch<double> one_by_one;
+        for (auto x : v)
+            one_by_one.add(x);
+        REQUIRE(std::abs(exact_rank(sorted, one_by_one.quantile(0.99)) - 0.99) < 0.017);
+    }
+}
+
+TEST_CASE("Merging quantile sketches", "[quantiles]")
+{
+    using namespace cinq;
+
+    std::vector<std::int64_t> v(1000000);
+    for (std::size_t i = 0; i < v.size(); ++i)
+        v[i] = static_cast<std::int64_t>((i * 7919) % v.size());
+    auto id = [](std::int64_t x) { return x; };
+
+    // Shards of different sizes, then sampling at different levels.
+    auto low = from(v) % where([](std::int64_t x) { return x < 100000; }) % quantile_sketch(id);
+    auto high = from(v) % where([](std::int64_t x) { return x >= 100000; }) % quantile_sketch(id);
+    low.merge(high);
+    REQUIRE(low.count() == v.size());
+    REQUIRE(low.retained() < 1000);
+    for (double q : {0.05, 0.5, 0.95})
+    {
+        const auto estimate = static_cast<double>(low.quantile(q));
+        REQUIRE(std::abs(estimate / static_cast<double>(v.size()) - q) < 0.017);
+    }
+
+    kll_sketch<std::int64_t> empty;
+    low.merge(empty);
+    REQUIRE(low.count() == v.size());
+    REQUIRE_THROWS_AS(low.merge(kll_sketch<std::int64_t>{100}), std::invalid_argument);
+}
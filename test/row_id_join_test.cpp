@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+namespace
+{
+    struct order
+    {
+        int id;
+        int customer;
+        double amount;
+        char padding[64];
+    };
+
+    struct customer
+    {
+        int id;
+        int region;
+        char padding[128];
+    };
+}
+
+TEST_CASE("Join yields row ids", "[row_id_join]")
+{
+    using namespace cinq;
+
+    std::vector<order> orders;
+    for (int i = 0; i < 5000; ++i)
+        orders.push_back({i, i % 700, i * 0.5, {}});
+    std::vector<customer> customers;
+    for (int i = 0; i < 600; ++i)
+        customers.push_back({i, i % 7, {}});
+
+    auto ids = from(orders) % join(customers).on_keys(&order::customer,
+                                                      &customer::id).row_ids();
+    std::vector<row_id_pair> rows(ids.begin(), ids.end());
+
+    std::vector<std::pair<int, int>> expected;
+    for (const auto& row : from(orders) % join(customers).on_keys(
+                 &order::customer, &customer::id))
+        expected.emplace_back(row.first.id, row.second.id);
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<std::pair<int, int>> found;
+    for (const auto& row : rows)
+        found.emplace_back(orders[row.first].id, customers[row.second].id);
+    std::sort(found.begin(), found.end());
+    REQUIRE(found.size() > 1024);
+    REQUIRE(found == expected);
+
+    SECTION("Gather")
+    {
+        std::vector<std::pair<int, int>> gathered;
+        auto joined = from(orders) % join(customers).on_keys(
+                &order::customer, &customer::id).row_ids() %
+                gather(orders, customers);
+        for (const auto& row : joined)
+            gathered.emplace_back(row.first.id, row.second.id);
+        std::sort(gathered.begin(), gathered.end());
+        REQUIRE(gathered == expected);
+    }
+    SECTION("Project")
+    {
+        double total = 0;
+        for (const auto& row : from(rows) % project(orders, &order::amount,
+                                                    customers, &customer::region))
+        {
+            if (row.second == 3)
+                total += row.first;
+        }
+        double expected_total = 0;
+        for (const auto& o : orders)
+            if (o.customer < 600 && o.customer % 7 == 3)
+                expected_total += o.amount;
+        REQUIRE(total == Approx(expected_total));
+    }
+}
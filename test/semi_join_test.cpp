@@ -0,0 +1,51 @@
+#include <list>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "cinq/cinq.hpp"
+
+TEST_CASE("Semi-join and anti-join", "[semi_join]")
+{
+    using namespace cinq;
+
+    std::vector<int> v = {0, 1, 2, 3, 4, 5};
+    std::vector<std::pair<int, char>> v2 = {
+            {0, 'a'}, {2, 'b'}, {2, 'c'}, {3, 'd'}, {3, 'e'}, {9, 'f'}};
+
+    auto key = [](const std::pair<int, char>& p) { return p.first; };
+    auto same = [](int i, const std::pair<int, char>& p)
+    {
+        return i == p.first;
+    };
+
+    SECTION("Semi-join on keys emits each match once")
+    {
+        auto result = from(v) % semi_join(v2).on_keys([](int i) { return i; },
+                                                      key);
+        REQUIRE(std::list<int>(result.begin(), result.end()) ==
+                std::list<int>{0, 2, 3});
+    }
+    SECTION("Anti-join on keys")
+    {
+        auto result = from(v) % anti_join(v2).on_keys([](int i) { return i; },
+                                                      key);
+        REQUIRE(std::list<int>(result.begin(), result.end()) ==
+                std::list<int>{1, 4, 5});
+    }
+    SECTION("Predicate forms")
+    {
+        auto semi = from(v) % semi_join(v2).on(same);
+        auto anti = from(v) % anti_join(v2).on(same);
+        REQUIRE(std::list<int>(semi.begin(), semi.end()) ==
+                std::list<int>{0, 2, 3});
+        REQUIRE(std::list<int>(anti.begin(), anti.end()) ==
+                std::list<int>{1, 4, 5});
+    }
+    SECTION("Composes with where and sum")
+    {
+        auto result = from(v) %
+                      where([](int i) { return i > 0; }) %
+                      semi_join(v2).on_keys([](int i) { return i; }, key) %
+                      sum()();
+        REQUIRE(result == 5);
+    }
+}
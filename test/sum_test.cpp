@@ -1,3 +1,10 @@
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <list>
+#include <numeric>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <catch2/catch.hpp>
 #include "cinq/cinq.hpp"
@@ -7,6 +14,14 @@ TEST_CASE("Empty input", "[sum]")
     REQUIRE(std::vector<int>{} % cinq::sum()() == 0);
 }
 
+TEST_CASE("Plain sum tags", "[sum]")
+{
+    // Names of the plain sum(), which predate sum modes.
+    static_assert(std::is_same<decltype(cinq::sum()), cinq::summer_tag>::value, "");
+    static_assert(std::is_same<decltype(cinq::sum()()), cinq::sum_tag>::value, "");
+    REQUIRE(std::vector<int>{1, 2} % cinq::sum_tag{} == 3);
+}
+
 TEST_CASE("Raw array", "[sum]")
 {
     int v[] = {0, 1, 2, 3, 4};
@@ -34,3 +49,292 @@ TEST_CASE("Simple sum query", "[sum]")
         REQUIRE(result() == 6);
     }
 }
+
+TEST_CASE("Vector kernels", "[sum]")
+{
+    using namespace cinq::detail;
+
+    std::vector<int> ints(300);
+    std::vector<double> doubles(300);
+    std::vector<float> floats(300);
+    for (int i = 0; i < 300; ++i)
+    {
+        ints[i] = i * 7 - 1000;
+        doubles[i] = i * 0.25;
+        floats[i] = static_cast<float>(i % 17);
+    }
+
+    for (auto isa : {simd_isa::scalar, simd_isa::sse2, simd_isa::avx2,
+                     simd_isa::avx512})
+    {
+        if (isa > simd_level())
+            continue;
+        for (std::size_t n : {0, 1, 7, 16, 63, 64, 65, 255, 300})
+        {
+            REQUIRE(simd_sum(ints.data(), n, isa) ==
+                    std::accumulate(ints.begin(), ints.begin() + n, 0));
+            REQUIRE(simd_sum(doubles.data(), n, isa) ==
+                    std::accumulate(doubles.begin(), doubles.begin() + n, 0.0));
+            REQUIRE(simd_sum(floats.data(), n, isa) ==
+                    std::accumulate(floats.begin(), floats.begin() + n, 0.0f));
+        }
+    }
+
+    SECTION("Contiguous iterators")
+    {
+        static_assert(is_contiguous<std::vector<float>::const_iterator>::value, "");
+        static_assert(!is_contiguous<std::vector<bool>::const_iterator>::value, "");
+        REQUIRE(floats % cinq::sum()() == 2367.0f);
+        REQUIRE(cinq::from(ints) % cinq::sum()() ==
+                std::accumulate(ints.begin(), ints.end(), 0));
+    }
+}
+
+TEST_CASE("Parallel sum", "[sum]")
+{
+    using namespace cinq;
+
+    thread_pool pool{4};
+    std::vector<long long> v(1000000);
+    std::iota(v.begin(), v.end(), 0);
+    const long long total = 999999LL * 1000000 / 2;
+
+    REQUIRE(v % sum().parallel(pool)() == total);
+    REQUIRE((from(v) % sum().parallel(pool))() == total);
+
+    SECTION("Through where")
+    {
+        auto even = [](long long i) { return i % 2 == 0; };
+        REQUIRE(from(v) % where(even) % sum().parallel(pool)() ==
+                from(v) % where(even) % sum()());
+    }
+    SECTION("Serial fallback")
+    {
+        std::list<int> l{1, 2, 3};
+        REQUIRE(l % sum().parallel(pool)() == 6);
+        REQUIRE(std::vector<int>{4, 5} % sum().parallel(pool)() == 9);
+    }
+}
+
+TEST_CASE("Fused where and sum", "[sum]")
+{
+    using namespace cinq;
+
+    std::vector<int> ints(1000);
+    std::vector<float> floats(1000);
+    std::vector<unsigned char> bytes(1000);
+    for (int i = 0; i < 1000; ++i)
+    {
+        ints[i] = i * 37 % 101 - 50;
+        floats[i] = static_cast<float>(i % 13);
+        bytes[i] = static_cast<unsigned char>(i);
+    }
+    floats[500] = std::numeric_limits<float>::infinity();
+    floats[501] = std::numeric_limits<float>::quiet_NaN();
+
+    auto positive = [](int i) { return i > 0; };
+    auto finite_small = [](float f) { return f < 6.0f; };
+    auto odd = [](unsigned char c) { return c % 2 == 1; };
+
+    auto expect = [](const auto& v, const auto& pred)
+    {
+        typename std::decay_t<decltype(v)>::value_type sum{};
+        for (auto x : v)
+            if (pred(x))
+                sum += x;
+        return sum;
+    };
+
+    for (auto isa : {detail::simd_isa::sse2, detail::simd_isa::avx2,
+                     detail::simd_isa::avx512})
+    {
+        if (isa > detail::simd_level())
+            continue;
+        for (std::size_t n : {0, 1, 31, 32, 33, 999, 1000})
+        {
+            std::vector<int> i(ints.begin(), ints.begin() + n);
+            std::vector<float> f(floats.begin(), floats.begin() + n);
+            REQUIRE(detail::masked_sum(i.data(), n, positive, isa) ==
+                    expect(i, positive));
+            REQUIRE(detail::masked_sum(f.data(), n, finite_small, isa) ==
+                    expect(f, finite_small));
+        }
+    }
+
+    REQUIRE(from(ints) % where(positive) % sum()() == expect(ints, positive));
+    REQUIRE(from(floats) % where(finite_small) % sum()() ==
+            expect(floats, finite_small));
+    REQUIRE(from(bytes) % where(odd) % sum()() == expect(bytes, odd));
+}
+
+TEST_CASE("Precise sum", "[sum]")
+{
+    using namespace cinq;
+
+    // Every group of four sums to 2, which plain summation loses entirely
+    // against the large terms.
+    std::vector<double> doubles;
+    std::vector<float> floats;
+    for (int i = 0; i < 1001; ++i)
+    {
+        doubles.insert(doubles.end(), {1.0, 1e100, 1.0, -1e100});
+        floats.insert(floats.end(), {1.0f, 1e30f, 1.0f, -1e30f});
+    }
+    REQUIRE(doubles % sum()() != 2002.0);
+
+    for (auto isa : {detail::simd_isa::sse2, detail::simd_isa::avx2,
+                     detail::simd_isa::avx512})
+    {
+        if (isa > detail::simd_level())
+            continue;
+        for (std::size_t n : {0, 4, 32, 36, 4000, 4004})
+        {
+            const auto groups = static_cast<double>(n / 4);
+            REQUIRE(detail::precise_sum(doubles.data(), n, detail::keep_all{},
+                                        isa).value() == 2 * groups);
+            REQUIRE(detail::precise_sum(floats.data(), n, detail::keep_all{},
+                                        isa).value() ==
+                    static_cast<float>(2 * groups));
+        }
+    }
+
+    REQUIRE(doubles % sum<precise>()() == 2002.0);
+    REQUIRE((from(floats) % sum<precise>())() == 2002.0f);
+    REQUIRE(std::list<double>(doubles.begin(), doubles.end()) %
+            sum<precise>()() == 2002.0);
+
+    SECTION("Through where and in parallel")
+    {
+        thread_pool pool{4};
+        auto not_huge = [](double d) { return d < 1e50; };
+        REQUIRE(from(doubles) % where(not_huge) % sum<precise>()() ==
+                -1e100 * 1001 + 2002.0);
+
+        std::vector<double> many;
+        for (int i = 0; i < 100; ++i)
+            many.insert(many.end(), doubles.begin(), doubles.end());
+        REQUIRE(many % sum<precise>().parallel(pool)() == 200200.0);
+    }
+    SECTION("Exact element types")
+    {
+        std::vector<int> ints = {1, 2, 3, 4};
+        REQUIRE(ints % sum<precise>()() == 10);
+    }
+}
+
+TEST_CASE("Widening sum", "[sum]")
+{
+    using namespace cinq;
+
+    std::vector<std::uint8_t> bytes(100000);
+    std::vector<std::int8_t> signed_bytes(100000);
+    std::vector<std::uint16_t> shorts(3000000);
+    std::vector<std::int16_t> signed_shorts(3000000);
+    for (std::size_t i = 0; i < bytes.size(); ++i)
+    {
+        bytes[i] = static_cast<std::uint8_t>(255 - i % 7);
+        signed_bytes[i] = static_cast<std::int8_t>(i % 2 ? -128 : 127 - i % 5);
+    }
+    for (std::size_t i = 0; i < shorts.size(); ++i)
+    {
+        shorts[i] = static_cast<std::uint16_t>(65535 - i % 3);
+        signed_shorts[i] = static_cast<std::int16_t>(i % 3 ? -32768 : 32767);
+    }
+
+    auto expect = [](const auto& v, std::size_t n)
+    {
+        return std::accumulate(v.begin(), v.begin() + n, std::int64_t{0});
+    };
+
+    for (auto isa : {detail::simd_isa::scalar, detail::simd_isa::sse2,
+                     detail::simd_isa::avx2, detail::simd_isa::avx512})
+    {
+        if (isa > detail::simd_level())
+            continue;
+        for (std::size_t n : {0, 1, 63, 64, 129, 100000})
+        {
+            REQUIRE(detail::widening_sum<std::int64_t>(bytes.data(), n, isa) ==
+                    expect(bytes, n));
+            REQUIRE(detail::widening_sum<std::int64_t>(signed_bytes.data(), n, isa) ==
+                    expect(signed_bytes, n));
+        }
+        // Long enough for the 32-bit lanes to be flushed several times.
+        for (std::size_t n : {0, 31, 65, 3000000})
+        {
+            REQUIRE(detail::widening_sum<std::int64_t>(shorts.data(), n, isa) ==
+                    expect(shorts, n));
+            REQUIRE(detail::widening_sum<std::int64_t>(signed_shorts.data(), n, isa) ==
+                    expect(signed_shorts, n));
+        }
+    }
+
+    REQUIRE(bytes % sum<std::int64_t>()() == expect(bytes, bytes.size()));
+    REQUIRE((from(shorts) % sum<std::uint32_t>())() ==
+            static_cast<std::uint32_t>(expect(shorts, shorts.size())));
+    REQUIRE(std::vector<int>{1 << 30, 1 << 30, 1 << 30} % sum<long long>()() ==
+            3LL << 30);
+    REQUIRE(std::vector<float>{0.5f, 0.25f} % sum<double>()() == 0.75);
+
+    SECTION("Through where and in parallel")
+    {
+        thread_pool pool{4};
+        auto odd = [](std::uint8_t b) { return b % 2 == 1; };
+        std::int64_t odd_sum = 0;
+        for (auto b : bytes)
+            if (odd(b))
+                odd_sum += b;
+        REQUIRE(from(bytes) % where(odd) % sum<std::int64_t>()() == odd_sum);
+        REQUIRE(signed_shorts % sum<std::int64_t>().parallel(pool)() ==
+                expect(signed_shorts, signed_shorts.size()));
+    }
+}
+
+namespace
+{
+    template <typename Range, typename = void>
+    struct sums_incrementally : std::false_type {};
+
+    template <typename Range>
+    struct sums_incrementally<Range, decltype(void(
+            std::declval<const Range&>() % cinq::sum().incremental()))>
+        : std::true_type {};
+}
+
+TEST_CASE("Incremental sum", "[sum]")
+{
+    using namespace cinq;
+
+    std::vector<int> metrics;
+    auto total = metrics % sum().incremental();
+    REQUIRE(total() == 0);
+
+    // Appending reallocates the vector; the handle only keeps a count.
+    for (int i = 1; i <= 1000; ++i)
+    {
+        metrics.push_back(i);
+        if (i % 100 == 0)
+            REQUIRE(total() == i * (i + 1) / 2);
+    }
+    REQUIRE(total.summed() == 1000);
+    REQUIRE(total() == 500500);
+
+    std::deque<std::uint8_t> bytes(100000, 255);
+    auto wide = bytes % sum<std::int64_t>().incremental();
+    REQUIRE(wide() == 25500000);
+    bytes.insert(bytes.end(), 100000, 1);
+    REQUIRE(wide() == 25600000);
+
+    // Compensation carries over from one call to the next.
+    std::vector<double> doubles = {1.0, 1e100};
+    auto precise_total = doubles % sum<precise>().incremental();
+    REQUIRE(precise_total() == 1e100);
+    doubles.insert(doubles.end(), {1.0, -1e100});
+    REQUIRE(precise_total() == 2.0);
+
+    // Views capture a fixed end, so they would never see appended elements.
+    auto positive = from(metrics) % where([](int i) { return i > 0; });
+    static_assert(sums_incrementally<std::vector<int>>::value, "");
+    static_assert(sums_incrementally<std::deque<std::uint8_t>>::value, "");
+    static_assert(!sums_incrementally<decltype(from(metrics))>::value, "");
+    static_assert(!sums_incrementally<decltype(positive)>::value, "");
+}
@@ -14,3 +14,15 @@ TEST_CASE("Simple from/where test", "[where]")
     std::list<int> v2(result.begin(), result.end());
     REQUIRE(v2 == std::list<int>{0, 2, 4});
 }
+
+TEST_CASE("Leading elements are filtered", "[where]")
+{
+    using namespace cinq;
+
+    std::vector<int> v = {1, 3, 4, 5, 6};
+    auto result = from(v) %
+                  where([](auto i) { return i % 2 == 0; });
+
+    std::list<int> v2(result.begin(), result.end());
+    REQUIRE(v2 == std::list<int>{4, 6});
+}